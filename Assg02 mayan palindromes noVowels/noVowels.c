@@ -5,105 +5,254 @@
  *
  * Purpose: Reads from stdin and prints out all words that match the first word when the vowels are removed
  * (case insensitive)
+ * Optional command-line args:
+ *   -f FILE   filter mode: load a list of reference words from FILE, then for every word on stdin that matches any of
+ *             them print "word: ref1 ref2 ..." with its matches in the order they appear in FILE. The references are
+ *             indexed by consonant key, so each word takes one key lookup however many references are loaded.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
+#include "consonantKey.h"
 
 /**
- * Returns whether 2 strings have matching consonants
- * @param a: first string; all chars are a-z
- * @param b: second string; all chars are a-z
- * @return 1 if the two strings match with vowels removed, 0 otherwise
+ * One reference word
  */
-int matchConsonants(char a[], char b[]) {
-    // Track current location in both strings
-    int aPos = 0;
-    int bPos = 0;
-    // Track current character in both strings
-    char aChar = a[aPos];
-    char bChar = b[bPos];
-    while (aChar != '\0' || bChar != '\0') {
-        // Increment aPos to skip over vowels
-        if (aChar == 'a' || aChar == 'e' || aChar == 'i' || aChar == 'o' || aChar == 'u') {
-            aPos++;
+typedef struct refNode {
+    char *word;
+    struct refNode *next;
+} refNode;
+
+/**
+ * All of the reference words that share a consonant key
+ */
+typedef struct refGroup {
+    char *key;
+    unsigned int hash;
+    refNode *words;
+    refNode *tail;
+} refGroup;
+
+/*
+ * Open-addressing hash table of reference groups by key
+ */
+refGroup **refSlots = NULL;
+int refCapacity = 0;
+int numRefGroups = 0;
+
+/**
+ * Print out an error and exit in the event a malloc fails
+ */
+void memError() {
+    fprintf(stderr, "Memory error.\n");
+    exit(1);
+}
+
+/**
+ * FNV-1a hash of a string
+ */
+unsigned int hashString(char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str) * 16777619u;
+        str++;
+    }
+    return hash;
+}
+
+/**
+ * Find the reference group with a key
+ * @param key : consonant key
+ * @param hash : hash of the key
+ * @return the slot holding the group, or the empty slot where it belongs
+ */
+int findSlot(char *key, unsigned int hash) {
+    int slot = (int) (hash & (unsigned int) (refCapacity - 1));
+    while (refSlots[slot] != NULL) {
+        if (refSlots[slot]->hash == hash && strcmp(refSlots[slot]->key, key) == 0) {
+            break;
         }
-            // Increment bPos to skip over vowels
-        else if (bChar == 'a' || bChar == 'e' || bChar == 'i' || bChar == 'o' || bChar == 'u') {
-            bPos++;
+        slot = (slot + 1) & (refCapacity - 1);
+    }
+    return slot;
+}
+
+/**
+ * Double the number of slots in the table and re-insert every group
+ */
+void growRefs() {
+    refGroup **oldSlots = refSlots;
+    int oldCapacity = refCapacity;
+    int i;
+    refCapacity = refCapacity == 0 ? 1024 : refCapacity * 2;
+    refSlots = calloc(refCapacity, sizeof(refGroup *));
+    if (refSlots == NULL) {
+        memError();
+    }
+    for (i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i] != NULL) {
+            refSlots[findSlot(oldSlots[i]->key, oldSlots[i]->hash)] = oldSlots[i];
         }
-            // Actually compare the two characters if neither is a vowel
-        else {
-            //Increment both positions, if not currently at the end
-            if (aChar != '\0') {
-                aPos++;
-            }
-            if (bChar != '\0') {
-                bPos++;
-            }
-            // If any two characters don't match, the whole strings don't match
-            if (aChar != bChar) {
-                return 0;
+    }
+    free(oldSlots);
+}
+
+/**
+ * Add a reference word to the group for its key
+ * @param word : reference word
+ * @param key : its consonant key
+ */
+void addRef(char *word, char *key) {
+    unsigned int hash = hashString(key);
+    int slot = findSlot(key, hash);
+    refGroup *group = refSlots[slot];
+    if (group == NULL) {
+        group = malloc(sizeof(refGroup));
+        if (group == NULL) {
+            memError();
+        }
+        group->key = strdup(key);
+        group->hash = hash;
+        group->words = NULL;
+        group->tail = NULL;
+        refSlots[slot] = group;
+        numRefGroups++;
+    }
+
+    refNode *newNode = malloc(sizeof(refNode));
+    if (newNode == NULL) {
+        memError();
+    }
+    newNode->word = strdup(word);
+    newNode->next = NULL;
+    if (group->tail == NULL) {
+        group->words = newNode;
+    }
+    else {
+        group->tail->next = newNode;
+    }
+    group->tail = newNode;
+
+    // Keep the table no more than half full
+    if (2 * numRefGroups > refCapacity) {
+        growRefs();
+    }
+}
+
+/**
+ * Free the reference table
+ */
+void freeRefs() {
+    int i;
+    for (i = 0; i < refCapacity; i++) {
+        if (refSlots[i] != NULL) {
+            refNode *cur = refSlots[i]->words;
+            while (cur != NULL) {
+                refNode *next = cur->next;
+                free(cur->word);
+                free(cur);
+                cur = next;
             }
+            free(refSlots[i]->key);
+            free(refSlots[i]);
+        }
+    }
+    free(refSlots);
+}
+
+/**
+ * Filter mode: load the reference words, then print each word on stdin that matches any of them, with its matches
+ * @param refFile : name of the file of reference words
+ * @return 1 if any word had a non-alphabetical character, 0 otherwise
+ */
+int filter(char *refFile) {
+    int retVal = 0;
+    char cur[65];
+    char curKey[65];
+
+    FILE *fileptr = fopen(refFile, "r");
+    if (fileptr == NULL) {
+        fprintf(stderr, "ERROR: couldn't open reference file %s.\n", refFile);
+        return 1;
+    }
+    growRefs();
+    while (fscanf(fileptr, "%64s", cur) != EOF) {
+        if (consonantKey(cur, curKey) < 0) {
+            fprintf(stderr, "ERROR: Reference word contained a non-alphabetical character.\n");
+            retVal++;
         }
+        else {
+            addRef(cur, curKey);
+        }
+    }
+    fclose(fileptr);
 
-        // Read next characters
-        aChar = a[aPos];
-        bChar = b[bPos];
+    while (scanf("%64s", cur) != EOF) {
+        if (consonantKey(cur, curKey) < 0) {
+            int i;
+            for (i = 0; isalpha(cur[i]); i++);
+            fprintf(stderr, "ERROR: Entry word contained a non-alphabetical character %c.\n", cur[i]);
+            retVal++;
+            continue;
+        }
+        refGroup *group = refSlots[findSlot(curKey, hashString(curKey))];
+        if (group != NULL) {
+            refNode *ref;
+            printf("%s:", cur);
+            for (ref = group->words; ref != NULL; ref = ref->next) {
+                printf(" %s", ref->word);
+            }
+            printf("\n");
+        }
     }
-    return 1;
+    freeRefs();
+
+    return (retVal > 0);
 }
 
-int main(void) {
+int main(int argc, char **argv) {
     int retVal = 0;
+    initKeyTable();
+
+    if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+        return filter(argv[2]);
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "ERROR: usage is noVowels [-f FILE].\n");
+        return 1;
+    }
 
-    // 2 versions of each string are needed: the one originally entered and the one converted to lowercase
+    // Each word is stored along with its consonant key, its lowercase letters with the vowels removed
     char first[65];
-    char firstProcessed[65];
+    char firstKey[65];
     char cur[65];
-    char curProcessed[65];
+    char curKey[65];
 
     // Store the first string
     scanf("%64s", first);
-    // Check to see if it's a valid word with only alphabetical characters; store the lowercase version of it
-    int i;
-    for (i = 0; first[i] != '\0'; i++) {
-        if (!isalpha(first[i])) {
-            fprintf(stderr, "ERROR: First word contained a non-alphabetical character. Exiting.\n");
-            return 1;
-        } else {
-            firstProcessed[i] = tolower(first[i]);
-        }
+    // Check to see if it's a valid word with only alphabetical characters; store its key
+    if (consonantKey(first, firstKey) < 0) {
+        fprintf(stderr, "ERROR: First word contained a non-alphabetical character. Exiting.\n");
+        return 1;
     }
-    // Null-terminate
-    firstProcessed[i] = '\0';
     // Always print the first word
     printf("%s\n", first);
 
     // Read words from stdin, compare to first word
     while (scanf("%64s", cur) != EOF) {
-        // Process the entered word. If it isn't entirely alphabetical, record an error. Otherwise, store the lowercase
-        // version and then check if consonants match first's
-        int i;
-        int valid = 1;
-        for (i = 0; cur[i] != '\0'; i++) {
-            if (!isalpha(cur[i])) {
-                fprintf(stderr, "ERROR: Entry word contained a non-alphabetical character %c.\n", cur[i]);
-                retVal++;
-                valid = 0;
-                break;
-            } else {
-                curProcessed[i] = tolower(cur[i]);
-            }
+        // If the word isn't entirely alphabetical, record an error for its first bad character. Otherwise, check if
+        // its key matches first's
+        if (consonantKey(cur, curKey) < 0) {
+            int i;
+            for (i = 0; isalpha(cur[i]); i++);
+            fprintf(stderr, "ERROR: Entry word contained a non-alphabetical character %c.\n", cur[i]);
+            retVal++;
         }
-        // Null-terminate
-        curProcessed[i] = '\0';
-        if (valid) {
-            int result = matchConsonants(firstProcessed, curProcessed);
-            // If the string matches the first string, print the original version of it before case changes
-            if (result == 1) {
-                printf("%s\n", cur);
-            }
+        // If the string matches the first string, print the original version of it before case changes
+        else if (strcmp(firstKey, curKey) == 0) {
+            printf("%s\n", cur);
         }
     }
 
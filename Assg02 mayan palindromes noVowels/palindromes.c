@@ -3,49 +3,191 @@
  *
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
- * Purpose: Determines whether strings are palindromes or not
+ * Purpose: Determines whether strings are palindromes or not (case insensitive)
+ * Optional command-line args:
+ *   -b      bulk mode: read stdin in large blocks and write the results in large batches. Output is the same.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE (1 << 24)
+#define OUT_SIZE (1 << 16)
+
+/*
+ * Each byte uppercased, the way toupper() does it
+ */
+unsigned char upperTable[256];
+
+#ifdef __SSE2__
 /**
- * Determines whether a string is a palindrome or not. Prints 1 if it is, 0 if it isn't
+ * Uppercase the letters in 16 bytes
+ */
+__m128i upper16(__m128i c) {
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+    return _mm_sub_epi8(c, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+}
+
+/**
+ * Reverse the order of 16 bytes
+ */
+__m128i reverse16(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+/**
+ * Determines whether a string is a palindrome or not, ignoring case
+ * 16 characters from the front are compared at once against the reversed 16 characters at the matching spot at the
+ * back, stopping at the first block with a mismatch; whatever is left in the middle is compared a pair at a time.
  * @param str: string to check
+ * @param size: number of characters in it
+ * @return 1 if it is a palindrome, 0 if it isn't
  */
-void palindrome(char str[]) {
-    int result = 1;
-
-    // Empty loop to get the size of the string
-    int size;
-    for (size = 0; str[size] != '\0'; size++) {}
-    // str[size] == '\0'
-
-    // Loop through the string. i only has to go to size/2, since odd numbers will skip the middle character,
-    // which is guaranteed to be palindromic
-    int i;
-    for (i = 0; i < size / 2; i++) {
+int palindrome(const char *str, size_t size) {
+    const unsigned char *word = (const unsigned char *) str;
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= size / 2; i += 16) {
+        __m128i head = upper16(_mm_loadu_si128((const __m128i *) (word + i)));
+        __m128i tail = upper16(_mm_loadu_si128((const __m128i *) (word + size - i - 16)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(head, reverse16(tail))) != 0xFFFF) {
+            return 0;
+        }
+    }
+#endif
+    // i only has to go to size/2, since odd numbers will skip the middle character, which is guaranteed to be
+    // palindromic
+    for (; i < size / 2; i++) {
         // Check matching letters at start and end of word, need offset since size is 1 past the end of the word
-        if(str[i] != str[size - (i + 1)]){
-            result = 0;
+        if (upperTable[word[i]] != upperTable[word[size - (i + 1)]]) {
+            return 0;
         }
     }
-    printf("%d\n", result);
+    return 1;
 }
 
-int main(void) {
-    int retVal = 0;
+/**
+ * Read the next whitespace-separated word from stdin, of any length
+ * @param buf: buffer for the word, grown as needed
+ * @param capacity: size of buf
+ * @return: length of the word, or EOF if there are no more words
+ */
+long readWord(char **buf, size_t *capacity) {
+    int c;
+    size_t length = 0;
+    while ((c = getchar_unlocked()) != EOF && isspace(c));
+    while (c != EOF && !isspace(c)) {
+        if (length + 1 >= *capacity) {
+            *capacity = *capacity == 0 ? 64 : *capacity * 2;
+            *buf = realloc(*buf, *capacity);
+            if (*buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        (*buf)[length++] = (char) c;
+        c = getchar_unlocked();
+    }
+    return length > 0 ? (long) length : EOF;
+}
+
+/**
+ * Bulk mode: check every word on stdin a block at a time
+ */
+void checkBulk() {
+    size_t capacity = BLOCK_SIZE;
+    size_t have = 0;
+    int done = 0;
+    char out[OUT_SIZE];
+    int outUsed = 0;
+    char *buf = malloc(capacity);
+    if (buf == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+
+    while (!done) {
+        // Grow the buffer if a single word filled it
+        if (have == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity);
+            if (buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        ssize_t got = read(STDIN_FILENO, buf + have, capacity - have);
+        if (got < 0) {
+            fprintf(stderr, "Error: couldn't read input.\n");
+            exit(1);
+        }
+        have += got;
+        done = (got == 0);
 
-    // Strings can be no longer than 64 chars
-    char str[65];
-    while (scanf("%64s", str) != EOF) {
-        // Convert str to uppercase
-        int i;
-        for(i = 0; str[i] != '\0'; i++){
-            str[i] = toupper(str[i]);
+        // Check every complete word; one cut off by the end of the buffer waits for the next read
+        char *pos = buf;
+        char *end = buf + have;
+        while (1) {
+            while (pos < end && isspace((unsigned char) *pos)) {
+                pos++;
+            }
+            char *word = pos;
+            while (pos < end && !isspace((unsigned char) *pos)) {
+                pos++;
+            }
+            if (word == pos || (pos == end && !done)) {
+                pos = word;
+                break;
+            }
+            if (outUsed + 2 > OUT_SIZE) {
+                fwrite(out, 1, outUsed, stdout);
+                outUsed = 0;
+            }
+            out[outUsed++] = (char) ('0' + palindrome(word, pos - word));
+            out[outUsed++] = '\n';
         }
-        palindrome(str);
+        have = end - pos;
+        memmove(buf, pos, have);
+    }
+    fwrite(out, 1, outUsed, stdout);
+    free(buf);
+}
+
+int main(int argc, char **argv) {
+    int retVal = 0;
+    int c;
+    for (c = 0; c < 256; c++) {
+        upperTable[c] = (unsigned char) toupper(c);
+    }
+
+    if (argc == 2 && strcmp(argv[1], "-b") == 0) {
+        checkBulk();
+        return 0;
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "Error: the only option is -b.\n");
+        return 1;
+    }
+
+    // Words can be any length; case is handled by palindrome()
+    char *str = NULL;
+    size_t capacity = 0;
+    long size;
+    while ((size = readWord(&str, &capacity)) != EOF) {
+        printf("%d\n", palindrome(str, size));
     }
+    free(str);
 
     // Return 0 if retVal == 0, 1 otherwise
     return (retVal > 0);
@@ -5,40 +5,268 @@
  *
  * Purpose: Reads in a number and a string. Rotates all letters by that number and prints out the rotated string.
  * Digits are unaffected. Ex: 2 aB1Z would print cE1B
+ * Optional command-line args:
+ *   -b      bulk mode: after the rotation, read stdin in large blocks and rotate every word with the lookup tables in
+ *           cipherKernel.c, writing the output in large blocks too. Output is the same as the default mode, except
+ *           words longer than 255 characters are kept whole instead of being split up, and a word containing a '\0'
+ *           is rejected instead of being cut short there.
+ *   -t N FILE
+ *           file mode: map FILE, which holds the rotation and the words just like stdin would, split it at whitespace
+ *           into N pieces, rotate the pieces on N threads, and write the output in one large write per piece. Output
+ *           and error messages are the same as -b.
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cipherKernel.h"
+
+#define BLOCK_SIZE (1 << 24)
+
+/**
+ * One thread's piece of the file in -t mode
+ */
+typedef struct rotateJob {
+    pthread_t thread;
+    char *start;
+    char *end;
+    char *out;
+    long outSize;
+    int errors;
+} rotateJob;
 
 /**
  * Perform a cipher rotation on the letters in a string, leaving digits unchanged and preserving case.
  *  Prints rotated version.
- * @param n: number of spaces to rotate. Assumed to be in the range [0, 26)
+ * Uses the rotation set up by initRotation().
  * @param str: string to process.
  */
-void rotate(int n, char *str) {
+void rotate(char *str) {
     // Create a new pointer to iterate through the string
     char *ptr = str;
     while (*ptr != '\0') {
-        // Rotate lowercase characters
-        if (*ptr >= 'a' && *ptr <= 'z') {
-            int offset = *ptr - 'a';
-            *ptr = 'a' + (offset + n) % 26;
-        }
-            // Rotate uppercase characters
-        else if (*ptr >= 'A' && *ptr <= 'Z') {
-            int offset = *ptr - 'A';
-            *ptr = 'A' + (offset + n) % 26;
-        }
+        *ptr = rotTable[(unsigned char) *ptr];
         ptr++;
     }
     printf("%s\n", str);
 }
 
-int main(void) {
+/**
+ * Bulk mode: rotate everything left on stdin a block at a time
+ * @return number of invalid words
+ */
+int rotateBulk() {
+    size_t capacity = BLOCK_SIZE;
+    size_t have = 0;
+    int errors = 0;
+    int done = 0;
+    char *in = malloc(capacity);
+    char *out = malloc(capacity + 1);
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+
+    while (!done) {
+        // Grow the buffers if a single word filled them
+        if (have == capacity) {
+            capacity *= 2;
+            in = realloc(in, capacity);
+            out = realloc(out, capacity + 1);
+            if (in == NULL || out == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        size_t got = fread(in + have, 1, capacity - have, stdin);
+        have += got;
+        done = (got == 0);
+
+        // Only rotate up to the last whitespace, unless there's no more input; carry the rest to the next block
+        size_t usable = have;
+        if (!done) {
+            while (usable > 0 && !isSpaceByte(in[usable - 1])) {
+                usable--;
+            }
+        }
+        int blockErrors = 0;
+        long outSize = rotateWords(in, in + usable, out, &blockErrors);
+        fwrite(out, 1, outSize, stdout);
+        for (; blockErrors > 0; blockErrors--) {
+            fprintf(stderr, "ERROR: Input string contained a non-alphanumeric character.\n");
+            errors++;
+        }
+        memmove(in, in + usable, have - usable);
+        have -= usable;
+    }
+    free(in);
+    free(out);
+    return errors;
+}
+
+/**
+ * Rotate one job's piece of the file into its part of the output buffer
+ * @param arg : the rotateJob
+ */
+void *rotateJobPiece(void *arg) {
+    rotateJob *job = arg;
+    job->outSize = rotateWords(job->start, job->end, job->out, &job->errors);
+    return NULL;
+}
+
+/**
+ * Write all of a buffer to stdout, retrying short writes
+ */
+void writeAll(char *buf, long size) {
+    while (size > 0) {
+        ssize_t written = write(STDOUT_FILENO, buf, size);
+        if (written <= 0) {
+            fprintf(stderr, "ERROR: couldn't write output.\n");
+            exit(1);
+        }
+        buf += written;
+        size -= written;
+    }
+}
+
+/**
+ * File mode: read the rotation from the start of a file, then rotate the rest of it on several threads
+ * @param filename : file to rotate
+ * @param numThreads : number of threads
+ * @return number of invalid words
+ */
+int rotateFile(char *filename, int numThreads) {
+    struct stat info;
+    int errors = 0;
+    int i;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "ERROR: couldn't open %s. Exiting.\n", filename);
+        exit(1);
+    }
+    size_t size = info.st_size;
+    char *data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "ERROR: couldn't map %s. Exiting.\n", filename);
+        exit(1);
+    }
+    if (size > 0) {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+    char *end = data + size;
+
+    // Read in the size of the rotation the way scanf("%d") would: strtol's value, truncated to an int
+    char *pos = data;
+    char number[64];
+    int length = 0;
+    while (pos < end && isspace((unsigned char) *pos)) {
+        pos++;
+    }
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        number[length++] = *pos++;
+    }
+    int digits = 0;
+    int significant = 0;
+    while (pos < end && isdigit((unsigned char) *pos)) {
+        // Leading zeros don't change the value, and past this many significant digits the value is clamped anyway
+        if (*pos != '0' || significant > 0) {
+            significant++;
+            if (length < (int) sizeof(number) - 2) {
+                number[length++] = *pos;
+            }
+        }
+        digits++;
+        pos++;
+    }
+    number[length] = '\0';
+    if (digits == 0) {
+        fprintf(stderr, "ERROR: First entry must be an integer. Exiting.\n");
+        exit(1);
+    }
+    int n = (int) strtol(number, NULL, 10);
+    n = (n%26 + 26) % 26;
+    initRotation(n);
+
+    // Split into roughly equal pieces, moving each boundary forward to the next whitespace. Each piece's output fits
+    // in its own size plus one byte, so piece i's output starts i bytes past where its input starts.
+    char *out = malloc(end - pos + numThreads);
+    rotateJob *jobs = calloc(numThreads, sizeof(rotateJob));
+    if (out == NULL || jobs == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    char *cursor = pos;
+    for (i = 0; i < numThreads; i++) {
+        char *pieceEnd = i == numThreads - 1 ? end : pos + (end - pos) / numThreads * (i + 1);
+        if (pieceEnd < cursor) {
+            pieceEnd = cursor;
+        }
+        while (pieceEnd < end && !isSpaceByte(*pieceEnd)) {
+            pieceEnd++;
+        }
+        jobs[i].start = cursor;
+        jobs[i].end = pieceEnd;
+        jobs[i].out = out + (cursor - pos) + i;
+        cursor = pieceEnd;
+    }
+
+    for (i = 1; i < numThreads; i++) {
+        if (pthread_create(&jobs[i].thread, NULL, rotateJobPiece, &jobs[i]) != 0) {
+            fprintf(stderr, "ERROR: couldn't create thread. Exiting.\n");
+            exit(1);
+        }
+    }
+    rotateJobPiece(&jobs[0]);
+    for (i = 1; i < numThreads; i++) {
+        pthread_join(jobs[i].thread, NULL);
+    }
+
+    // Output and errors in piece order, which is input order
+    for (i = 0; i < numThreads; i++) {
+        writeAll(jobs[i].out, jobs[i].outSize);
+        for (; jobs[i].errors > 0; jobs[i].errors--) {
+            fprintf(stderr, "ERROR: Input string contained a non-alphanumeric character.\n");
+            errors++;
+        }
+    }
+
+    free(jobs);
+    free(out);
+    if (size > 0) {
+        munmap(data, size);
+    }
+    close(fd);
+    return errors;
+}
+
+int main(int argc, char **argv) {
     int retVal = 0;
     int n;
     char str[256];
+    int bulk = 0;
+    if (argc == 2 && strcmp(argv[1], "-b") == 0) {
+        bulk = 1;
+    }
+    else if (argc == 4 && strcmp(argv[1], "-t") == 0) {
+        char *end;
+        int numThreads = (int) strtol(argv[2], &end, 10);
+        if (*end != '\0' || numThreads <= 0) {
+            fprintf(stderr, "ERROR: -t must be followed by a positive number of threads. Exiting.\n");
+            exit(1);
+        }
+        return (rotateFile(argv[3], numThreads) > 0);
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "ERROR: the options are -b and -t N FILE. Exiting.\n");
+        exit(1);
+    }
     // Read in the size of the rotation
     if (scanf("%d", &n) < 1) {
         fprintf(stderr, "ERROR: First entry must be an integer. Exiting.\n");
@@ -49,6 +277,11 @@ int main(void) {
     // Add 26 to force it to be a positive integer
     // %26 again to force it back to 0-26
     n = (n%26 + 26) % 26;
+    initRotation(n);
+
+    if (bulk) {
+        return (rotateBulk() > 0);
+    }
 
     // Read words from stdin
     while (scanf("%255s", str) != EOF) {
@@ -65,7 +298,7 @@ int main(void) {
         }
         // Do the rotation if the string is valid
         if (valid) {
-            rotate(n, str);
+            rotate(str);
         }
     }
     // Return 0 if retVal == 0, 1 otherwise
@@ -0,0 +1,129 @@
+/*
+ * File: cipherBench.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Benchmark for the cipher rotation. Builds a buffer of random words in memory, then rotates all of it the
+ *          old way (an isalnum check and a branch and % 26 per byte) and with rotateWords() from cipherKernel.c,
+ *          checks that both give the same output, and prints the throughput of each in GB/s.
+ *          Usage: cipherBench [megabytes]  (default 256)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include "cipherKernel.h"
+
+#define ROTATION 13
+
+/**
+ * Wall clock time in seconds
+ */
+double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Rotate every word in a buffer the way cipher's rotate() used to, writing each valid word and a newline to out
+ * @return number of bytes written to out
+ */
+long oldRotate(const char *start, const char *end, char *out, int n, int *errors) {
+    const char *pos = start;
+    char *outPos = out;
+    while (pos < end) {
+        while (pos < end && isspace((unsigned char) *pos)) {
+            pos++;
+        }
+        const char *word = pos;
+        while (pos < end && !isspace((unsigned char) *pos)) {
+            pos++;
+        }
+        if (word == pos) {
+            break;
+        }
+        const char *ptr;
+        int valid = 1;
+        for (ptr = word; ptr < pos; ptr++) {
+            if (!isalnum((unsigned char) *ptr)) {
+                valid = 0;
+                break;
+            }
+        }
+        if (!valid) {
+            (*errors)++;
+            continue;
+        }
+        for (ptr = word; ptr < pos; ptr++) {
+            if (*ptr >= 'a' && *ptr <= 'z') {
+                *outPos++ = 'a' + (*ptr - 'a' + n) % 26;
+            }
+            else if (*ptr >= 'A' && *ptr <= 'Z') {
+                *outPos++ = 'A' + (*ptr - 'A' + n) % 26;
+            }
+            else {
+                *outPos++ = *ptr;
+            }
+        }
+        *outPos++ = '\n';
+    }
+    return outPos - out;
+}
+
+int main(int argc, char **argv) {
+    const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    long size = (argc > 1 ? atol(argv[1]) : 256) * 1000000L;
+    if (size <= 0) {
+        fprintf(stderr, "Usage: cipherBench [megabytes]\n");
+        exit(1);
+    }
+    char *in = malloc(size);
+    char *oldOut = malloc(size + 1);
+    char *newOut = malloc(size + 1);
+    if (in == NULL || oldOut == NULL || newOut == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+
+    // Random words of 1 to 12 characters, one in a thousand with punctuation, separated by spaces or newlines
+    long i = 0;
+    srand(45);
+    while (i < size) {
+        int length = 1 + rand() % 12;
+        while (length-- > 0 && i < size) {
+            in[i++] = rand() % 1000 == 0 ? '!' : letters[rand() % (sizeof(letters) - 1)];
+        }
+        if (i < size) {
+            in[i++] = rand() % 10 == 0 ? '\n' : ' ';
+        }
+    }
+
+    // Touch the output buffers first so page faults aren't part of the timing
+    memset(oldOut, 0, size + 1);
+    memset(newOut, 0, size + 1);
+    int oldErrors = 0, newErrors = 0;
+    double startTime = now();
+    long oldSize = oldRotate(in, in + size, oldOut, ROTATION, &oldErrors);
+    double oldTime = now() - startTime;
+
+    initRotation(ROTATION);
+    startTime = now();
+    long newSize = rotateWords(in, in + size, newOut, &newErrors);
+    double newTime = now() - startTime;
+
+    if (oldSize != newSize || oldErrors != newErrors || memcmp(oldOut, newOut, oldSize) != 0) {
+        fprintf(stderr, "Error: the rotations disagree.\n");
+        exit(1);
+    }
+    printf("%.0f MB, %d invalid words\n", size / 1e6, newErrors);
+    printf("branch and %% 26: %.2f GB/s\n", size / oldTime / 1e9);
+    printf("rotateWords:     %.2f GB/s\n", size / newTime / 1e9);
+
+    free(in);
+    free(oldOut);
+    free(newOut);
+    return 0;
+}
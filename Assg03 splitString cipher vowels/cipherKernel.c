@@ -0,0 +1,174 @@
+/*
+ * File: cipherKernel.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Table-driven cipher rotation. Once the rotation is known, every byte's rotated value and whether it is a
+ *          letter, digit or whitespace are looked up in 256-entry tables, so there's no % 26 or character range
+ *          checks. rotateWords() also avoids branching on word boundaries, which are unpredictable in real text: every
+ *          byte is stored, and arithmetic on the byte's class decides whether the output position moves past it.
+ *          With SSE2, 16-byte pieces that hold only letters, digits and single whitespace characters between words
+ *          (the usual case) are rotated with vector compares and adds and stored directly.
+ */
+
+#include "cipherKernel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CLASS_OTHER 0
+#define CLASS_ALNUM 1
+#define CLASS_SPACE 2
+
+/*
+ * Each byte's rotated value. Anything other than a letter maps to itself.
+ */
+char rotTable[256];
+
+/*
+ * Each byte's class, with whitespace matching isspace() in the C locale
+ */
+static unsigned char byteClass[256];
+
+/*
+ * What rotateWords() stores for each byte: the rotated value, or a newline for whitespace
+ */
+static char outTable[256];
+
+static int rotation;
+
+/**
+ * Fill in the tables for a rotation
+ * @param n : number of spaces to rotate. Assumed to be in the range [0, 26)
+ */
+void initRotation(int n) {
+    int c;
+    rotation = n;
+    for (c = 0; c < 256; c++) {
+        rotTable[c] = (char) c;
+        byteClass[c] = CLASS_OTHER;
+    }
+    for (c = 0; c < 26; c++) {
+        rotTable['a' + c] = (char) ('a' + (c + n) % 26);
+        rotTable['A' + c] = (char) ('A' + (c + n) % 26);
+        byteClass['a' + c] = CLASS_ALNUM;
+        byteClass['A' + c] = CLASS_ALNUM;
+    }
+    for (c = '0'; c <= '9'; c++) {
+        byteClass[c] = CLASS_ALNUM;
+    }
+    byteClass[' '] = CLASS_SPACE;
+    for (c = '\t'; c <= '\r'; c++) {
+        byteClass[c] = CLASS_SPACE;
+    }
+    for (c = 0; c < 256; c++) {
+        outTable[c] = byteClass[c] == CLASS_SPACE ? '\n' : rotTable[c];
+    }
+}
+
+/**
+ * Returns whether a byte is whitespace
+ */
+int isSpaceByte(char c) {
+    return byteClass[(unsigned char) c] == CLASS_SPACE;
+}
+
+#ifdef __SSE2__
+/**
+ * Rotate 16 bytes at once if they're all letters, digits or whitespace with no two whitespace bytes in a row
+ * @param pos : bytes to rotate
+ * @param out : where to store the rotated bytes, with a newline in place of each whitespace byte
+ * @param afterSpace : whether the byte before pos was whitespace or the start of the block
+ * @return bitmask of the whitespace bytes, or -1 if the bytes need the byte-at-a-time loop
+ */
+int rotate16(const unsigned char *pos, char *out, int afterSpace) {
+    __m128i c = _mm_loadu_si128((const __m128i *) pos);
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                                  _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                                                _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1))));
+    int spaceMask = _mm_movemask_epi8(spaces);
+    int goodMask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), spaces));
+    if (goodMask != 0xFFFF || (spaceMask & ((spaceMask << 1) | afterSpace)) != 0) {
+        return -1;
+    }
+
+    // Letters move forward by the rotation, and back 26 if that goes past z
+    __m128i wraps = _mm_cmpgt_epi8(_mm_sub_epi8(lower, _mm_set1_epi8('a')), _mm_set1_epi8((char) (25 - rotation)));
+    __m128i delta = _mm_sub_epi8(_mm_and_si128(letters, _mm_set1_epi8((char) rotation)),
+                                 _mm_and_si128(_mm_and_si128(letters, wraps), _mm_set1_epi8(26)));
+    __m128i rotated = _mm_add_epi8(c, delta);
+    rotated = _mm_or_si128(_mm_and_si128(spaces, _mm_set1_epi8('\n')), _mm_andnot_si128(spaces, rotated));
+    _mm_storeu_si128((__m128i *) out, rotated);
+    return spaceMask;
+}
+#endif
+
+/**
+ * Rotate every whitespace-separated word in a block, writing each valid word and a newline to out. Words that aren't
+ * all letters and digits are skipped and counted.
+ * @param start : first byte of the block
+ * @param end : one past the last byte; the block must not end partway through a word
+ * @param out : output buffer, with room for at least (end - start) + 1 bytes
+ * @param errors : incremented once per invalid word
+ * @return number of bytes written to out
+ */
+long rotateWords(const char *start, const char *end, char *out, int *errors) {
+    const unsigned char *pos = (const unsigned char *) start;
+    const unsigned char *stop = (const unsigned char *) end;
+    long outPos = 0;
+    long wordStart = 0;     // where the current word's output starts
+    int inWord = 0;
+    int valid = CLASS_ALNUM;
+    int badWords = 0;
+
+    while (pos < stop) {
+        const unsigned char *pieceEnd = stop - pos > 16 ? pos + 16 : stop;
+#ifdef __SSE2__
+        if (pieceEnd - pos == 16 && valid) {
+            int spaceMask = rotate16(pos, out + outPos, !inWord);
+            if (spaceMask >= 0) {
+                // Every word in the piece was valid; the next one starts after the last newline
+                if (spaceMask != 0) {
+                    wordStart = outPos + 32 - __builtin_clz((unsigned) spaceMask);
+                }
+                outPos += 16;
+                inWord = !(spaceMask & 0x8000);
+                pos += 16;
+                continue;
+            }
+        }
+#endif
+        for (; pos < pieceEnd; pos++) {
+            int byteType = byteClass[*pos];
+            int space = byteType >> 1;
+            out[outPos] = outTable[*pos];
+            // Keep word bytes, and the newline stored for the first whitespace after a word
+            outPos += (!space) | inWord;
+            // A word that just ended with a bad byte in it is taken back out
+            int bad = space & inWord & !valid;
+            badWords += bad;
+            outPos = bad ? wordStart : outPos;
+            valid = space ? CLASS_ALNUM : (valid & byteType);
+            wordStart = space ? outPos : wordStart;
+            inWord = !space;
+        }
+    }
+
+    // The block can end in the middle of the last word
+    if (inWord) {
+        if (valid) {
+            out[outPos++] = '\n';
+        }
+        else {
+            outPos = wordStart;
+            badWords++;
+        }
+    }
+    *errors += badWords;
+    return outPos;
+}
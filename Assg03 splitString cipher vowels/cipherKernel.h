@@ -0,0 +1,27 @@
+/*
+ * File: cipherKernel.h
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Header file for cipherKernel.c, the table-driven rotation used by cipher's bulk modes
+ */
+
+#ifndef _CIPHERKERNEL_H
+#define _CIPHERKERNEL_H
+
+/*
+ * Globals
+ */
+extern char rotTable[256];
+
+/*
+ * Public Functions
+ */
+
+void initRotation(int n);
+
+int isSpaceByte(char c);
+
+long rotateWords(const char *start, const char *end, char *out, int *errors);
+
+#endif
@@ -4,8 +4,63 @@
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
  * Purpose: Reads from stdin and splits all strings on the '-' character, ignoring leading and trailing ones
+ * Optional command-line args:
+ *   -s      streaming mode: read stdin in large blocks and write the pieces out with writev(), with no limit on word
+ *           length. Long pieces are written straight out of the input buffer; short ones and the newlines are
+ *           gathered into a small staging buffer first, since the kernel handles a few large iovecs much faster than
+ *           many tiny ones. Output is byte-for-byte the same as the default mode for words of
+ *           up to 255 characters; longer words are split only at dashes instead of also every 255 characters.
+ *   -d DELIMS [-f LIST] [-k]
+ *           field mode: split each line of stdin on any of the bytes in DELIMS (using splitter.c). Runs of delimiters
+ *           count as one and are ignored at the ends of a line, like the default mode, unless -k keeps the empty
+ *           fields. Without -f every field is printed on its own line. With -f, only the fields in LIST (1-based, such
+ *           as 1,3-5,7-) are printed, one line per input line, joined by the first delimiter.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include "splitter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE (1 << 24)
+#define MAX_IOVECS 1024
+#define STAGE_SIZE (1 << 16)
+#define COPY_LIMIT 64
+
+#define CLASS_WORD 0
+#define CLASS_DASH 1
+#define CLASS_SPACE 2
+#define CLASS_NULL 3
+
+/*
+ * Each byte's class: part of a piece, a dash, whitespace (as isspace() sees it), or '\0', which ends a word early the
+ * same way it ends the string scanf() stored
+ */
+unsigned char byteClass[256];
+
+#define MAX_RANGES 64
+
+/*
+ * A range of selected fields for -f, inclusive and 1-based
+ */
+typedef struct fieldRange {
+    int low;
+    int high;
+} fieldRange;
+
+/*
+ * Pieces waiting to be written, each followed by a newline
+ */
+struct iovec iovecs[MAX_IOVECS];
+int numIovecs = 0;
+char stage[STAGE_SIZE];
+int stageUsed = 0;
 
 /**
  * Print out all pieces of a string separated by the dash characters
@@ -39,9 +94,378 @@ void split(char *str) {
     }
 }
 
-int main(void) {
+/**
+ * Write out all of the waiting pieces, retrying short writes
+ */
+void flushPieces() {
+    struct iovec *iov = iovecs;
+    int count = numIovecs;
+    while (count > 0) {
+        ssize_t written = writev(STDOUT_FILENO, iov, count);
+        if (written < 0) {
+            fprintf(stderr, "Error: couldn't write output.\n");
+            exit(1);
+        }
+        // Skip the iovecs that were written completely, and move into a partly written one
+        while (count > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    numIovecs = 0;
+    stageUsed = 0;
+}
+
+/**
+ * Copy bytes into the staging buffer, growing the last iovec if it already ends where they go
+ * The caller makes sure there's room
+ */
+void stageBytes(char *start, size_t length) {
+    char *dest = stage + stageUsed;
+    memcpy(dest, start, length);
+    stageUsed += (int) length;
+    if (numIovecs > 0 && (char *) iovecs[numIovecs - 1].iov_base + iovecs[numIovecs - 1].iov_len == dest) {
+        iovecs[numIovecs - 1].iov_len += length;
+    }
+    else {
+        iovecs[numIovecs].iov_base = dest;
+        iovecs[numIovecs++].iov_len = length;
+    }
+}
+
+/**
+ * Queue a piece and a newline to be written
+ * @param start : first byte of the piece, which must stay in place until flushPieces()
+ * @param length : length of the piece
+ */
+void addPiece(char *start, size_t length) {
+    if (numIovecs + 2 > MAX_IOVECS || stageUsed + COPY_LIMIT + 1 > STAGE_SIZE) {
+        flushPieces();
+    }
+    if (length < COPY_LIMIT) {
+        stageBytes(start, length);
+    }
+    else {
+        iovecs[numIovecs].iov_base = start;
+        iovecs[numIovecs++].iov_len = length;
+    }
+    stageBytes("\n", 1);
+}
+
+/**
+ * Find the end of a piece: the first byte at or after pos that isn't part of one
+ * @return that byte, or end if the piece runs to the end of the buffer
+ */
+char *pieceEnd(char *pos, char *end) {
+#ifdef __SSE2__
+    // Check 16 bytes at a time for dashes, whitespace and nulls
+    while (end - pos >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *) pos);
+        __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')), _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+        stops = _mm_or_si128(stops, _mm_cmpeq_epi8(c, _mm_setzero_si128()));
+        stops = _mm_or_si128(stops, _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+                                                  _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1))));
+        int mask = _mm_movemask_epi8(stops);
+        if (mask != 0) {
+            return pos + __builtin_ctz((unsigned) mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < end && byteClass[(unsigned char) *pos] == CLASS_WORD) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Streaming mode: split everything on stdin without copying the pieces
+ */
+void streamSplit() {
+    size_t capacity = BLOCK_SIZE;
+    size_t have = 0;
+    int skipping = 0;       // after a '\0', ignore the rest of the word
+    int done = 0;
+    int c;
+    char *buf = malloc(capacity);
+    if (buf == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    for (c = 0; c < 256; c++) {
+        byteClass[c] = CLASS_WORD;
+    }
+    byteClass['-'] = CLASS_DASH;
+    byteClass[' '] = CLASS_SPACE;
+    for (c = '\t'; c <= '\r'; c++) {
+        byteClass[c] = CLASS_SPACE;
+    }
+    byteClass['\0'] = CLASS_NULL;
+
+    while (!done) {
+        // Grow the buffer if a single piece filled it
+        if (have == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity);
+            if (buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        ssize_t got = read(STDIN_FILENO, buf + have, capacity - have);
+        if (got < 0) {
+            fprintf(stderr, "Error: couldn't read input.\n");
+            exit(1);
+        }
+        have += got;
+        done = (got == 0);
+
+        char *pos = buf;
+        char *end = buf + have;
+        char *carry = end;
+        while (pos < end) {
+            if (skipping) {
+                while (pos < end && byteClass[(unsigned char) *pos] != CLASS_SPACE) {
+                    pos++;
+                }
+                if (pos == end) {
+                    break;
+                }
+                skipping = 0;
+            }
+            // Skip dashes and whitespace
+            while (pos < end && (byteClass[(unsigned char) *pos] == CLASS_DASH ||
+                                 byteClass[(unsigned char) *pos] == CLASS_SPACE)) {
+                pos++;
+            }
+            if (pos == end) {
+                break;
+            }
+
+            char *start = pos;
+            pos = pieceEnd(pos, end);
+            // A piece cut off by the end of the buffer is finished after the next read
+            if (pos == end && !done) {
+                carry = start;
+                break;
+            }
+            if (pos > start) {
+                addPiece(start, pos - start);
+            }
+            if (pos < end && byteClass[(unsigned char) *pos] == CLASS_NULL) {
+                skipping = 1;
+            }
+        }
+
+        // The pieces point into buf, so write them before moving the carried bytes
+        flushPieces();
+        have = end - carry;
+        memmove(buf, carry, have);
+    }
+    free(buf);
+}
+
+/**
+ * Parse a field list like 1,3-5,7-
+ * @param list : the list
+ * @param ranges : filled in with the ranges
+ * @return the number of ranges, or -1 if the list isn't valid
+ */
+int parseFieldList(char *list, fieldRange *ranges) {
+    int numRanges = 0;
+    char *pos = list;
+    while (*pos != '\0') {
+        if (numRanges == MAX_RANGES) {
+            return -1;
+        }
+        char *after;
+        long low = 1, high;
+        if (*pos != '-') {
+            low = strtol(pos, &after, 10);
+            if (after == pos || low < 1 || low > INT_MAX) {
+                return -1;
+            }
+            pos = after;
+        }
+        high = low;
+        if (*pos == '-') {
+            pos++;
+            high = INT_MAX;
+            if (*pos != ',' && *pos != '\0') {
+                high = strtol(pos, &after, 10);
+                if (after == pos || high < low || high > INT_MAX) {
+                    return -1;
+                }
+                pos = after;
+            }
+        }
+        if (*pos == ',') {
+            pos++;
+            if (*pos == '\0') {
+                return -1;
+            }
+        }
+        else if (*pos != '\0') {
+            return -1;
+        }
+        ranges[numRanges].low = (int) low;
+        ranges[numRanges++].high = (int) high;
+    }
+    return numRanges;
+}
+
+/**
+ * Print the fields of one line
+ * @param sp : splitter for the delimiters
+ * @param start : first byte of the line
+ * @param end : one past its last byte, not counting the newline
+ * @param ranges : selected fields, or NULL to print every field on its own line
+ * @param numRanges : number of ranges
+ * @param fields : buffer for the field spans, grown as needed
+ * @param maxFields : size of fields
+ */
+void printFields(splitter *sp, const char *start, const char *end, fieldRange *ranges, int numRanges,
+                 fieldSpan **fields, int *maxFields) {
+    int numFields = splitFields(sp, start, end, *fields, *maxFields);
+    int i, r;
+    if (numFields > *maxFields) {
+        *maxFields = numFields * 2;
+        free(*fields);
+        *fields = malloc(*maxFields * sizeof(fieldSpan));
+        if (*fields == NULL) {
+            fprintf(stderr, "Memory error.\n");
+            exit(1);
+        }
+        splitFields(sp, start, end, *fields, *maxFields);
+    }
+
+    if (ranges == NULL) {
+        for (i = 0; i < numFields; i++) {
+            fwrite((*fields)[i].start, 1, (*fields)[i].length, stdout);
+            putchar('\n');
+        }
+        return;
+    }
+    int printed = 0;
+    for (i = 0; i < numFields; i++) {
+        for (r = 0; r < numRanges; r++) {
+            if (i + 1 >= ranges[r].low && i + 1 <= ranges[r].high) {
+                break;
+            }
+        }
+        if (r < numRanges) {
+            if (printed++ > 0) {
+                putchar(sp->delims[0]);
+            }
+            fwrite((*fields)[i].start, 1, (*fields)[i].length, stdout);
+        }
+    }
+    putchar('\n');
+}
+
+/**
+ * Field mode: split every line of stdin on a set of delimiters
+ * @param delims : delimiter bytes
+ * @param ranges : selected fields, or NULL for all of them
+ * @param numRanges : number of ranges
+ * @param keepEmpty : 1 to keep empty fields instead of collapsing runs of delimiters
+ */
+void fieldSplit(char *delims, fieldRange *ranges, int numRanges, int keepEmpty) {
+    splitter sp;
+    size_t capacity = BLOCK_SIZE;
+    size_t have = 0;
+    int done = 0;
+    int maxFields = 64;
+    char *buf = malloc(capacity);
+    fieldSpan *fields = malloc(maxFields * sizeof(fieldSpan));
+    if (buf == NULL || fields == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    initSplitter(&sp, delims, strlen(delims), !keepEmpty);
+
+    while (!done) {
+        // Grow the buffer if a single line filled it
+        if (have == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity);
+            if (buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        ssize_t got = read(STDIN_FILENO, buf + have, capacity - have);
+        if (got < 0) {
+            fprintf(stderr, "Error: couldn't read input.\n");
+            exit(1);
+        }
+        have += got;
+        done = (got == 0);
+
+        // Split every complete line; an unfinished one waits for the next read unless the input is over
+        char *pos = buf;
+        char *end = buf + have;
+        while (pos < end) {
+            char *lineEnd = memchr(pos, '\n', end - pos);
+            if (lineEnd == NULL) {
+                if (!done) {
+                    break;
+                }
+                lineEnd = end;
+            }
+            printFields(&sp, pos, lineEnd, ranges, numRanges, &fields, &maxFields);
+            pos = lineEnd < end ? lineEnd + 1 : end;
+        }
+        have = end - pos;
+        memmove(buf, pos, have);
+    }
+    free(fields);
+    free(buf);
+}
+
+int main(int argc, char **argv) {
     int retVal = 0;
     char str[256];
+    if (argc == 2 && strcmp(argv[1], "-s") == 0) {
+        streamSplit();
+        return 0;
+    }
+    else if (argc > 1) {
+        char *delims = NULL;
+        fieldRange ranges[MAX_RANGES];
+        int numRanges = -1;
+        int keepEmpty = 0;
+        int i;
+        for (i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+                delims = argv[++i];
+            }
+            else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+                numRanges = parseFieldList(argv[++i], ranges);
+                if (numRanges <= 0) {
+                    fprintf(stderr, "Error: bad field list %s.\n", argv[i]);
+                    return 1;
+                }
+            }
+            else if (strcmp(argv[i], "-k") == 0) {
+                keepEmpty = 1;
+            }
+            else {
+                break;
+            }
+        }
+        if (i < argc || delims == NULL || delims[0] == '\0' || strchr(delims, '\n') != NULL) {
+            fprintf(stderr, "Error: usage is splitString [-s | -d DELIMS [-f LIST] [-k]]. DELIMS can't have a newline.\n");
+            return 1;
+        }
+        fieldSplit(delims, numRanges > 0 ? ranges : NULL, numRanges, keepEmpty);
+        return 0;
+    }
     // Read words from stdin
     while (scanf("%255s", str) != EOF) {
         split(str);
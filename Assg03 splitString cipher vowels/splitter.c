@@ -0,0 +1,113 @@
+/*
+ * File: splitter.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: General field splitter. Any set of bytes can be delimiters; each byte is classified with a 256-entry
+ *          table, and with SSE2 a set of up to MAX_VECTOR_DELIMS delimiters is matched 16 bytes at a time. Fields come
+ *          back as spans pointing into the caller's buffer, so nothing is copied.
+ */
+
+#include <string.h>
+#include "splitter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Set up a splitter
+ * @param sp : splitter to initialize
+ * @param delims : the delimiter bytes, which may include '\0'
+ * @param numDelims : number of delimiter bytes
+ * @param collapse : 1 to treat runs of delimiters as one and ignore them at the ends, like split(); 0 to keep the
+ *                   empty fields between them
+ */
+void initSplitter(splitter *sp, const char *delims, size_t numDelims, int collapse) {
+    size_t i;
+    memset(sp->isDelim, 0, sizeof(sp->isDelim));
+    sp->numDelims = 0;
+    sp->collapse = collapse;
+    for (i = 0; i < numDelims; i++) {
+        unsigned char c = (unsigned char) delims[i];
+        if (!sp->isDelim[c]) {
+            sp->isDelim[c] = 1;
+            if (sp->numDelims < MAX_VECTOR_DELIMS) {
+                sp->delims[sp->numDelims] = c;
+            }
+            sp->numDelims++;
+        }
+    }
+}
+
+/**
+ * Find the next delimiter
+ * @param sp : splitter
+ * @param pos : where to start looking
+ * @param end : end of the buffer
+ * @return the first delimiter at or after pos, or end if there isn't one
+ */
+const char *findDelim(const splitter *sp, const char *pos, const char *end) {
+#ifdef __SSE2__
+    if (sp->numDelims <= MAX_VECTOR_DELIMS) {
+        __m128i targets[MAX_VECTOR_DELIMS];
+        int i;
+        for (i = 0; i < sp->numDelims; i++) {
+            targets[i] = _mm_set1_epi8((char) sp->delims[i]);
+        }
+        while (end - pos >= 16) {
+            __m128i c = _mm_loadu_si128((const __m128i *) pos);
+            __m128i matches = _mm_setzero_si128();
+            for (i = 0; i < sp->numDelims; i++) {
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(c, targets[i]));
+            }
+            int mask = _mm_movemask_epi8(matches);
+            if (mask != 0) {
+                return pos + __builtin_ctz((unsigned) mask);
+            }
+            pos += 16;
+        }
+    }
+#endif
+    while (pos < end && !sp->isDelim[(unsigned char) *pos]) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Split a buffer into fields
+ * @param sp : splitter
+ * @param start : first byte of the buffer
+ * @param end : one past the last byte
+ * @param fields : filled in with up to maxFields spans, in order
+ * @param maxFields : size of fields
+ * @return the number of fields found, which can be more than maxFields
+ */
+int splitFields(const splitter *sp, const char *start, const char *end, fieldSpan *fields, int maxFields) {
+    const char *pos = start;
+    int numFields = 0;
+
+    while (1) {
+        if (sp->collapse) {
+            while (pos < end && sp->isDelim[(unsigned char) *pos]) {
+                pos++;
+            }
+            if (pos == end) {
+                break;
+            }
+        }
+        const char *fieldEnd = findDelim(sp, pos, end);
+        if (numFields < maxFields) {
+            fields[numFields].start = pos;
+            fields[numFields].length = fieldEnd - pos;
+        }
+        numFields++;
+        // Without collapsing, a delimiter at the very end still has an empty field after it
+        if (fieldEnd == end) {
+            break;
+        }
+        pos = fieldEnd + 1;
+    }
+    return numFields;
+}
@@ -0,0 +1,42 @@
+/*
+ * File: splitter.h
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Header file for splitter.c, a field splitter that finds fields separated by any of a set of delimiter
+ *          bytes and hands them back as spans into the caller's buffer without copying
+ */
+
+#ifndef _SPLITTER_H
+#define _SPLITTER_H
+
+#include <stddef.h>
+
+#define MAX_VECTOR_DELIMS 8
+
+/*
+ * Typedefs
+ */
+typedef struct fieldSpan {
+    const char *start;
+    size_t length;
+} fieldSpan;
+
+typedef struct splitter {
+    unsigned char isDelim[256];
+    unsigned char delims[MAX_VECTOR_DELIMS];    // the delimiters, for vector matching when there are few enough
+    int numDelims;
+    int collapse;                               // ignore leading, trailing and repeated delimiters like split()
+} splitter;
+
+/*
+ * Public Functions
+ */
+
+void initSplitter(splitter *sp, const char *delims, size_t numDelims, int collapse);
+
+const char *findDelim(const splitter *sp, const char *pos, const char *end);
+
+int splitFields(const splitter *sp, const char *start, const char *end, fieldSpan *fields, int maxFields);
+
+#endif
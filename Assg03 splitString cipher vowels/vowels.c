@@ -4,65 +4,204 @@
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
  * Purpose: Prints whether all the vowels of words read from stdin occur in alphabetical order
+ * Optional command-line args:
+ *   -b      bulk mode: read stdin in large blocks and write the results in large batches. Output is the same.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE (1 << 24)
+#define OUT_SIZE (1 << 16)
+
+#define CLASS_BAD 0
+#define CLASS_CONSONANT 1
+#define CLASS_SPACE 7
+
+/*
+ * Each byte's class: CLASS_BAD for anything that isn't a letter or whitespace, CLASS_CONSONANT, 2 through 6 for the
+ * vowels a, e, i, o and u in either case, or CLASS_SPACE. Looking a byte up checks it, lowercases it and ranks it at
+ * once.
+ */
+unsigned char byteClass[256];
+
+/**
+ * Fill in the byte class table
+ */
+void initClasses() {
+    const char vowels[] = "aeiou";
+    int c;
+    for (c = 0; c < 256; c++) {
+        byteClass[c] = CLASS_BAD;
+    }
+    for (c = 'a'; c <= 'z'; c++) {
+        byteClass[c] = CLASS_CONSONANT;
+        byteClass[toupper(c)] = CLASS_CONSONANT;
+    }
+    for (c = 0; c < 5; c++) {
+        byteClass[(unsigned char) vowels[c]] = (unsigned char) (2 + c);
+        byteClass[toupper(vowels[c])] = (unsigned char) (2 + c);
+    }
+    byteClass[' '] = CLASS_SPACE;
+    for (c = '\t'; c <= '\r'; c++) {
+        byteClass[c] = CLASS_SPACE;
+    }
+}
 
 /**
- * Check whether all vowels in a word occur in alphabetical order
- * @param str: string to check. Assumed to be lowercase and only containing a-z
- * @return: 1 if all vowels in order; 0 otherwise
+ * Check that a word is all letters and whether all of its vowels occur in alphabetical order, in one pass
+ * @param word: word to check, in any case
+ * @param length: number of characters in the word
+ * @return: 1 if all vowels in order; 0 otherwise; -1 if the word has a non-alphabetical character
  */
-int checkVowels(char *str){
-    char *ptr = str;
-    int result = 1;
+int checkVowels(const char *word, size_t length) {
+    const unsigned char *ptr = (const unsigned char *) word;
+    const unsigned char *end = ptr + length;
+    int bad = 0;
+    int outOfOrder = 0;
     // Store 'biggest' vowel seen
-    char biggestVowel = 0;
-    while(*ptr != '\0'){
-        // If a vowel is encountered, check to see if a bigger one has been seen
-        if(*ptr == 'a' || *ptr == 'e' || *ptr == 'i' || *ptr == 'o' || *ptr == 'u'){
-            if(biggestVowel > *ptr){
-                // If so, not in order
-                return 0;
-            }
-            else{
-                biggestVowel = *ptr;
+    int biggestVowel = 0;
+    for (; ptr < end; ptr++) {
+        int type = byteClass[*ptr];
+        bad |= (type == CLASS_BAD) | (type == CLASS_SPACE);
+        // Consonants rank 0, so they never count as out of order or as the biggest vowel
+        int rank = type > CLASS_CONSONANT ? type : 0;
+        outOfOrder |= rank != 0 && rank < biggestVowel;
+        biggestVowel = rank > biggestVowel ? rank : biggestVowel;
+    }
+    return bad ? -1 : !outOfOrder;
+}
+
+/**
+ * Read the next whitespace-separated word from stdin, of any length
+ * @param buf: buffer for the word, grown as needed
+ * @param capacity: size of buf
+ * @return: length of the word, or EOF if there are no more words
+ */
+long readWord(char **buf, size_t *capacity) {
+    int c;
+    size_t length = 0;
+    while ((c = getchar()) != EOF && byteClass[c] == CLASS_SPACE);
+    while (c != EOF && byteClass[c] != CLASS_SPACE) {
+        if (length + 1 >= *capacity) {
+            *capacity = *capacity == 0 ? 64 : *capacity * 2;
+            *buf = realloc(*buf, *capacity);
+            if (*buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
             }
         }
-        ptr++;
+        (*buf)[length++] = (char) c;
+        c = getchar();
     }
-    return result;
+    return length > 0 ? (long) length : EOF;
 }
 
-int main(void) {
-    int retVal = 0;
-    char str[65];
+/**
+ * Bulk mode: check every word on stdin a block at a time
+ * @return: number of words with a non-alphabetical character
+ */
+int checkBulk() {
+    size_t capacity = BLOCK_SIZE;
+    size_t have = 0;
+    int errors = 0;
+    int done = 0;
+    char out[OUT_SIZE];
+    int outUsed = 0;
+    char *buf = malloc(capacity);
+    if (buf == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
 
-    // Read words from stdin
-    while (scanf("%64s", str) != EOF) {
-        int i;
-        // Convert the string to lowercase and check if it's valid (no non-alphabetical characters)
-        int valid = 1;
-        for (i = 0; str[i] != '\0'; i++) {
-            // Uppercase get converted
-            if (str[i] >= 'A' && str[i] <= 'Z') {
-                str[i] = tolower(str[i]);
+    while (!done) {
+        // Grow the buffer if a single word filled it
+        if (have == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity);
+            if (buf == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
             }
-            // Anything that isn't lowercase is an error
-            else if (!(str[i] >= 'a' && str[i] <= 'z')) {
-                valid = 0;
-                fprintf(stderr, "ERROR: Non-alphabetical character in the word.\n");
-                retVal++;
+        }
+        ssize_t got = read(STDIN_FILENO, buf + have, capacity - have);
+        if (got < 0) {
+            fprintf(stderr, "ERROR: couldn't read input.\n");
+            exit(1);
+        }
+        have += got;
+        done = (got == 0);
+
+        // Check every complete word; one cut off by the end of the buffer waits for the next read
+        char *pos = buf;
+        char *end = buf + have;
+        while (1) {
+            while (pos < end && byteClass[(unsigned char) *pos] == CLASS_SPACE) {
+                pos++;
+            }
+            char *word = pos;
+            while (pos < end && byteClass[(unsigned char) *pos] != CLASS_SPACE) {
+                pos++;
+            }
+            if (word == pos || (pos == end && !done)) {
+                pos = word;
                 break;
             }
+            int result = checkVowels(word, pos - word);
+            if (result < 0) {
+                // Write out the results so far so they stay in order with the error
+                fwrite(out, 1, outUsed, stdout);
+                outUsed = 0;
+                fflush(stdout);
+                fprintf(stderr, "ERROR: Non-alphabetical character in the word.\n");
+                errors++;
+                continue;
+            }
+            if (outUsed + 2 > OUT_SIZE) {
+                fwrite(out, 1, outUsed, stdout);
+                outUsed = 0;
+            }
+            out[outUsed++] = (char) ('0' + result);
+            out[outUsed++] = '\n';
         }
-        // Check the vowels on valid words
-        if (valid) {
-            printf("%d\n", checkVowels(str));
+        have = end - pos;
+        memmove(buf, pos, have);
+    }
+    fwrite(out, 1, outUsed, stdout);
+    free(buf);
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    int retVal = 0;
+    char *str = NULL;
+    size_t capacity = 0;
+    long length;
+
+    initClasses();
+    if (argc == 2 && strcmp(argv[1], "-b") == 0) {
+        return (checkBulk() > 0);
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "ERROR: the only option is -b.\n");
+        return 1;
+    }
+
+    // Read words from stdin; any length is fine
+    while ((length = readWord(&str, &capacity)) != EOF) {
+        // Check the vowels on valid words; anything that isn't a letter is an error
+        int result = checkVowels(str, length);
+        if (result < 0) {
+            fprintf(stderr, "ERROR: Non-alphabetical character in the word.\n");
+            retVal++;
+        }
+        else {
+            printf("%d\n", result);
         }
     }
+    free(str);
     // Return 0 if retVal == 0, 1 otherwise
     return (retVal > 0);
 }
-
-
@@ -0,0 +1,81 @@
+/*
+ * File: intReaderBench.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Times reading every integer in a file with scanf("%d") against the buffered intReader, checks that both
+ *          read the same values, and prints the throughput of each. Usage: intReaderBench FILE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "intReader.h"
+
+/**
+ * Wall clock time in seconds
+ */
+double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: intReaderBench FILE\n");
+        exit(1);
+    }
+    struct stat info;
+    if (stat(argv[1], &info) != 0) {
+        fprintf(stderr, "Error opening file %s.\n", argv[1]);
+        exit(1);
+    }
+    double megabytes = info.st_size / 1e6;
+    long scanfCount = 0, readerCount = 0;
+    long scanfSum = 0, readerSum = 0;
+    int val;
+    double startTime, elapsed;
+
+    // scanf("%d")
+    FILE *fileptr = fopen(argv[1], "r");
+    if (fileptr == NULL) {
+        fprintf(stderr, "Error opening file %s.\n", argv[1]);
+        exit(1);
+    }
+    startTime = now();
+    while (fscanf(fileptr, "%d", &val) == 1) {
+        scanfSum += val;
+        scanfCount++;
+    }
+    elapsed = now() - startTime;
+    fclose(fileptr);
+    printf("scanf:     %ld ints in %.3f s, %.1f MB/s\n", scanfCount, elapsed, megabytes / elapsed);
+
+    // intReader
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file %s.\n", argv[1]);
+        exit(1);
+    }
+    intReader reader;
+    initReader(&reader, fd);
+    startTime = now();
+    while (readInt(&reader, &val) == 1) {
+        readerSum += val;
+        readerCount++;
+    }
+    elapsed = now() - startTime;
+    freeReader(&reader);
+    close(fd);
+    printf("intReader: %ld ints in %.3f s, %.1f MB/s\n", readerCount, elapsed, megabytes / elapsed);
+
+    if (readerCount != scanfCount || readerSum != scanfSum) {
+        fprintf(stderr, "Error: the readers disagree.\n");
+        return 1;
+    }
+    return 0;
+}
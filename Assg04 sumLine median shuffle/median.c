@@ -8,13 +8,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include "intReader.h"
 
 int main(void) {
     int retVal = 0;
+    intReader reader;
+    initReader(&reader, STDIN_FILENO);
 
     // Read in the number of elements of the array
     int size;
-    if (scanf("%d", &size) != 1 || size < 0) {
+    if (readInt(&reader, &size) != 1 || size < 0) {
         fprintf(stderr, "Error: The line didn't start with a positive number.\n");
         exit(1);
     }
@@ -30,11 +34,12 @@ int main(void) {
     // Read in the values
     int i;
     for (i = 0; i < size; i++) {
-        if (scanf("%d", &array[i]) != 1) {
+        if (readInt(&reader, &array[i]) != 1) {
             fprintf(stderr, "Error reading index %d.\n", i);
             exit(1);
         }
     }
+    freeReader(&reader);
 
     // Sort the array using a simple bubble sort
     int j;
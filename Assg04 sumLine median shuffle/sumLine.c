@@ -8,67 +8,61 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include "intReader.h"
 
 
 int main(void) {
     // Flag errors
     int retVal = 0;
-    // getline pointers
-    char *line = NULL;
-    size_t size = 0;
+    // Buffered reader on stdin
+    intReader reader;
+    initReader(&reader, STDIN_FILENO);
 
     // Process lines until EOF reached
-    while (getline(&line, &size, stdin) != EOF) {
-        // Memory error: line is NULL
-        if (line == NULL) {
-            fprintf(stderr, "Memory error reading in line.");
-            exit(1);
-        }
+    while (peekChar(&reader) != EOF) {
         // Blank line
-        if(line[0] == '\n'){
+        if (peekChar(&reader) == '\n') {
+            skipLine(&reader);
             retVal++;
             fprintf(stderr, "Empty line.\n");
             continue;
         }
 
-        // Successful read: parse the line
+        // Parse the line
         int error = 0;
         int total = 0;
-        char *curChar = line;
         int curNum;
-        int charsRead;
-        int scanResults = 0;
+        int scanResults;
 
-        // Scan the line for integers until the end of it is reached
-        while (*curChar != '\0' && scanResults != EOF) {
-            scanResults = sscanf(curChar, "%d%n", &curNum, &charsRead);
+        // Read integers until the end of the line is reached
+        while ((scanResults = readLineInt(&reader, &curNum)) != EOF) {
             if (scanResults == 0) {
                 fprintf(stderr, "Error: didn't read a number.\n");
                 retVal++;
                 error = 1;
                 break;
             }
-            else if (scanResults == 1) {
-                if (curNum < 0) {
-                    fprintf(stderr, "Error: read a negative integer.\n");
-                    retVal++;
-                    error = 1;
-                    break;
-                }
-                // Successful read: add curNum to the total
-                else {
-                    total += curNum;
-                    // Increment the pointer by how many characters were taken off the line
-                    curChar += charsRead;
-                }
+            else if (curNum < 0) {
+                fprintf(stderr, "Error: read a negative integer.\n");
+                retVal++;
+                error = 1;
+                break;
+            }
+            // Successful read: add curNum to the total
+            else {
+                total += curNum;
             }
         }
-        // Only print the total if no errors were encountered
-        if (error == 0) {
+        // Skip the rest of a line that had an error, and only print the total if there wasn't one
+        if (error) {
+            skipLine(&reader);
+        }
+        else {
             printf("%d\n", total);
         }
     }
-    free(line);
+    freeReader(&reader);
 
     return (retVal > 0);
 }
\ No newline at end of file
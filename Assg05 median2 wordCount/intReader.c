@@ -0,0 +1,194 @@
+/*
+ * File: intReader.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Buffered integer reader. Input is pulled in with read() a megabyte at a time and digits are parsed by
+ *          hand, which is many times faster than scanf("%d"). Results match scanf: leading whitespace is skipped,
+ *          one optional sign is allowed, a sign without digits after it is a failed read, and an out of range value
+ *          gives the same int glibc's scanf stores (strtol's clamped long, truncated to an int).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "intReader.h"
+
+#define READ_SIZE (1 << 20)
+
+/**
+ * Set up a reader on a file descriptor
+ * @param reader : reader to initialize
+ * @param fd : file descriptor to read from
+ */
+void initReader(intReader *reader, int fd) {
+    reader->fd = fd;
+    reader->buf = malloc(READ_SIZE);
+    if (reader->buf == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = 0;
+}
+
+/**
+ * Free a reader's buffer. The file descriptor is left open.
+ */
+void freeReader(intReader *reader) {
+    free(reader->buf);
+    reader->buf = NULL;
+}
+
+/**
+ * Refill the buffer once everything in it has been used
+ * @return 1 if there is more input, 0 at end of input
+ */
+int fill(intReader *reader) {
+    ssize_t bytesRead;
+    if (reader->eof) {
+        return 0;
+    }
+    do {
+        bytesRead = read(reader->fd, reader->buf, READ_SIZE);
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead <= 0) {
+        reader->eof = 1;
+        return 0;
+    }
+    reader->start = 0;
+    reader->end = (int) bytesRead;
+    return 1;
+}
+
+/**
+ * Look at the next byte without using it up
+ * @return the byte, or EOF at end of input
+ */
+int peekChar(intReader *reader) {
+    if (reader->start == reader->end && !fill(reader)) {
+        return EOF;
+    }
+    return (unsigned char) reader->buf[reader->start];
+}
+
+/**
+ * Whitespace as isspace() sees it in the C locale
+ */
+int isSpace(int c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Parse an optionally signed run of digits starting at the next byte
+ * @param val : where to store the value
+ * @return 1 if an integer was read, 0 if there were no digits
+ */
+int parseDigits(intReader *reader, int *val) {
+    // Anything past this has already overflowed a long, so the magnitude saturates here
+    const unsigned long limit = (unsigned long) LONG_MAX + 1;
+    unsigned long magnitude = 0;
+    int negative = 0;
+    int digits = 0;
+    int c = peekChar(reader);
+
+    if (c == '-' || c == '+') {
+        negative = (c == '-');
+        reader->start++;
+    }
+    while (1) {
+        // Fast path: digits already in the buffer
+        char *pos = reader->buf + reader->start;
+        char *end = reader->buf + reader->end;
+        while (pos < end && (unsigned) (*pos - '0') < 10) {
+            unsigned long digit = (unsigned) (*pos - '0');
+            if (magnitude > (limit - digit) / 10) {
+                magnitude = limit;
+            }
+            else {
+                magnitude = magnitude * 10 + digit;
+            }
+            pos++;
+        }
+        digits += (int) (pos - (reader->buf + reader->start));
+        reader->start = (int) (pos - reader->buf);
+        // Stop unless the number runs on past the end of the buffer
+        if (pos < end || !fill(reader)) {
+            break;
+        }
+    }
+    if (digits == 0) {
+        return 0;
+    }
+
+    long clamped;
+    if (negative) {
+        clamped = magnitude >= limit ? LONG_MIN : -(long) magnitude;
+    }
+    else {
+        clamped = magnitude > LONG_MAX ? LONG_MAX : (long) magnitude;
+    }
+    *val = (int) clamped;
+    return 1;
+}
+
+/**
+ * Read the next integer, the way scanf("%d") does
+ * @param val : where to store the value
+ * @return 1 if an integer was read, 0 if the next input isn't an integer, EOF if only whitespace was left
+ */
+int readInt(intReader *reader, int *val) {
+    while (1) {
+        char *pos = reader->buf + reader->start;
+        char *end = reader->buf + reader->end;
+        while (pos < end && isSpace((unsigned char) *pos)) {
+            pos++;
+        }
+        reader->start = (int) (pos - reader->buf);
+        if (pos < end) {
+            return parseDigits(reader, val);
+        }
+        if (!fill(reader)) {
+            return EOF;
+        }
+    }
+}
+
+/**
+ * Read the next integer on the current line, the way sscanf("%d") does on a line from getline(). The end of the line
+ * is used up when it's reached, and a '\0' ends the line early just as it ends sscanf's string.
+ * @param val : where to store the value
+ * @return 1 if an integer was read, 0 if the next input isn't an integer, EOF at the end of the line
+ */
+int readLineInt(intReader *reader, int *val) {
+    int c;
+    while ((c = peekChar(reader)) != EOF && c != '\n' && isSpace(c)) {
+        reader->start++;
+    }
+    if (c == EOF) {
+        return EOF;
+    }
+    if (c == '\n' || c == '\0') {
+        skipLine(reader);
+        return EOF;
+    }
+    return parseDigits(reader, val);
+}
+
+/**
+ * Skip past the end of the current line
+ */
+void skipLine(intReader *reader) {
+    while (peekChar(reader) != EOF) {
+        char *newline = memchr(reader->buf + reader->start, '\n', reader->end - reader->start);
+        if (newline != NULL) {
+            reader->start = (int) (newline - reader->buf) + 1;
+            return;
+        }
+        reader->start = reader->end;
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * File: intReader.h
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Header file for intReader.c, a buffered reader that parses integers straight out of large read() chunks
+ *          instead of going through scanf
+ */
+
+#ifndef _INTREADER_H
+#define _INTREADER_H
+
+/*
+ * Typedefs
+ */
+typedef struct intReader {
+    int fd;
+    char *buf;
+    int start;          // next unread byte
+    int end;            // one past the last buffered byte
+    int eof;            // set once read() returns 0
+} intReader;
+
+/*
+ * Public Functions
+ */
+
+void initReader(intReader *reader, int fd);
+
+void freeReader(intReader *reader);
+
+int readInt(intReader *reader, int *val);
+
+int readLineInt(intReader *reader, int *val);
+
+int peekChar(intReader *reader);
+
+void skipLine(intReader *reader);
+
+#endif
@@ -3,122 +3,795 @@
  *
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
- * Purpose: Reads in integers from stdin, creates a linked list of the values, and computes the median of them
+ * Purpose: Reads in integers from stdin, stores them in a growable array, and computes the median of them
+ * Optional command-line args:
+ *   -s      streaming: print the median of everything read so far after every value
+ *   -w N    windowed streaming: print the median of the last N values after every value
+ *   -q [-p P]... [file]...
+ *           sketch mode for data too big for memory: read each file (or stdin) into a KLL quantile sketch on its own
+ *           thread, merge the sketches, and print the requested percentiles (default p50, p90 and p99) as "pP value".
+ *           With the default sketch size each reported value's rank is within about 1.7% of the requested rank
+ *           with 99% confidence, using a few kilobytes per sketch no matter how much input there is.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "intReader.h"
 
 /**
- * Nodes of the linked list: need an int and a next pointer
+ * Growable array of the values read in
  */
-typedef struct node {
-    int val;
-    struct node *next;
-} node;
+typedef struct intArray {
+    int *vals;
+    int size;
+    int capacity;
+} intArray;
 
 /**
- * Get the node at index i of a linked list
- * @param i : index to retrieve
- * @return pointer to that node
+ * Add a value to the end of an array, doubling its capacity when it's full
+ * @param array : array to add to
+ * @param val : value to add
  */
-node *getNode(node *head, int i) {
-    int count = 0;
-    node *retVal = head;
-    while (count < i) {
-        retVal = retVal->next;
-        count++;
+void append(intArray *array, int val) {
+    if (array->size == array->capacity) {
+        array->capacity = array->capacity == 0 ? 1024 : array->capacity * 2;
+        array->vals = realloc(array->vals, array->capacity * sizeof(int));
+        if (array->vals == NULL) {
+            fprintf(stderr, "Memory error\n");
+            exit(1);
+        }
     }
-    return retVal;
+    array->vals[array->size++] = val;
 }
 
 /**
- * Return the median of a linked list
- * @param head : head of linked list
- * @return median as a float
+ * Restore the heap property of a max-heap by moving element i down
+ * @param vals : heap array
+ * @param size : number of elements in the heap
+ * @param i : index to sift down
+ */
+void siftDown(int *vals, int size, int i) {
+    while (1) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < size && vals[left] > vals[largest]) {
+            largest = left;
+        }
+        if (right < size && vals[right] > vals[largest]) {
+            largest = right;
+        }
+        if (largest == i) {
+            return;
+        }
+        int temp = vals[i];
+        vals[i] = vals[largest];
+        vals[largest] = temp;
+        i = largest;
+    }
+}
+
+/**
+ * Heapsort a range of values: the worst-case fallback for selectKth()
+ * @param vals : values to sort
+ * @param size : number of values
+ */
+void heapSort(int *vals, int size) {
+    int i;
+    for (i = size / 2 - 1; i >= 0; i--) {
+        siftDown(vals, size, i);
+    }
+    for (i = size - 1; i > 0; i--) {
+        int temp = vals[0];
+        vals[0] = vals[i];
+        vals[i] = temp;
+        siftDown(vals, i, 0);
+    }
+}
+
+/**
+ * Rearrange an array so vals[k] holds the value that would be there if it were sorted, everything before it is
+ * no larger and everything after it is no smaller (introselect: quickselect with a median-of-3 pivot and a three-way
+ * partition, falling back to heapsort on the remaining range if it makes too little progress)
+ * @param vals : values to rearrange
+ * @param size : number of values
+ * @param k : index to select
  */
-float computeMedian(node *head) {
-    node *ptr = head;
-    int size = 0;
+void selectKth(int *vals, int size, int k) {
+    int lo = 0;
+    int hi = size - 1;
+    int budget = 0;
+    while ((1 << budget) < size && budget < 30) {
+        budget++;
+    }
+    budget *= 2;
+
+    while (hi > lo) {
+        if (budget-- == 0) {
+            heapSort(vals + lo, hi - lo + 1);
+            return;
+        }
+        // Median of the first, middle and last values
+        int a = vals[lo], b = vals[lo + (hi - lo) / 2], c = vals[hi];
+        int pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
 
-    // Find the size of the list
-    while (ptr != NULL) {
-        size++;
-        ptr = ptr->next;
+        // Partition into [lo, lt) < pivot, [lt, gt] == pivot, (gt, hi] > pivot
+        int lt = lo, gt = hi, i = lo;
+        while (i <= gt) {
+            if (vals[i] < pivot) {
+                int temp = vals[i];
+                vals[i++] = vals[lt];
+                vals[lt++] = temp;
+            }
+            else if (vals[i] > pivot) {
+                int temp = vals[i];
+                vals[i] = vals[gt];
+                vals[gt--] = temp;
+            }
+            else {
+                i++;
+            }
+        }
+        if (k < lt) {
+            hi = lt - 1;
+        }
+        else if (k > gt) {
+            lo = gt + 1;
+        }
+        else {
+            return;
+        }
     }
+}
+
+/**
+ * Return the median of an array of values (the values are rearranged)
+ * @param array : values to find the median of
+ * @return median as a float
+ */
+float computeMedian(intArray *array) {
+    int size = array->size;
+    int *vals = array->vals;
 
     // Find the median
     float retVal;
+    selectKth(vals, size, size / 2);
     // Odd: middle number
     if (size % 2 == 1) {
-        retVal = getNode(head, size / 2)->val;
+        retVal = vals[size / 2];
     }
-        // Odd: average of two middle values
+        // Even: average of two middle values. The lower one is the largest value before the upper one
     else {
-        retVal = (float) (getNode(head, size / 2 - 1)->val + getNode(head, size / 2)->val) / 2;
+        int lower = vals[0];
+        int i;
+        for (i = 1; i < size / 2; i++) {
+            if (vals[i] > lower) {
+                lower = vals[i];
+            }
+        }
+        retVal = (float) (lower + vals[size / 2]) / 2;
     }
     return retVal;
 }
 
+/*
+ * Streaming medians. The running median keeps the smaller half of the values in a max-heap and the larger half in a
+ * min-heap, with the max-heap holding the extra value when the count is odd. The windowed median keeps the window
+ * sorted in an indexable skiplist, whose links record how many values they skip, so the middle values can be found
+ * (and the oldest value removed) in O(log N).
+ */
+#define SKIP_MAX_LEVELS 32
+
+typedef struct heap {
+    int *vals;
+    int size;
+    int capacity;
+    int isMin;
+} heap;
+
+typedef struct skipNode {
+    int val;
+    int levels;
+    struct skipNode **next;
+    int *width;             // number of values the link at each level moves forward by
+} skipNode;
+
+heap lowHalf = {NULL, 0, 0, 0};
+heap highHalf = {NULL, 0, 0, 1};
+
+skipNode *skipHead;
+int skipLevels;
+int skipSize;
+int *window;
+int windowSize;
+int windowStart;
+
 /**
- * Bubble-sort the items in a linked list
- * @param head : head of linked list to sort
+ * Check whether value a belongs above value b in a heap
  */
-void sortList(node *head) {
-    node *iptr, *jptr;
+int heapBefore(heap *h, int a, int b) {
+    return h->isMin ? a < b : a > b;
+}
 
-    // Find the size of the linked list
-    int size = 0;
-    iptr = head;
-    while (iptr != NULL) {
-        size++;
-        iptr = iptr->next;
+/**
+ * Add a value to a heap
+ */
+void heapPush(heap *h, int val) {
+    if (h->size == h->capacity) {
+        h->capacity = h->capacity == 0 ? 1024 : h->capacity * 2;
+        h->vals = realloc(h->vals, h->capacity * sizeof(int));
+        if (h->vals == NULL) {
+            fprintf(stderr, "Memory error\n");
+            exit(1);
+        }
     }
+    int i = h->size++;
+    while (i > 0 && heapBefore(h, val, h->vals[(i - 1) / 2])) {
+        h->vals[i] = h->vals[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->vals[i] = val;
+}
 
-    // Sort the linked list using a simple bubble sort
-    int i, j;
-    for (i = 0; i < size - 1; i++) {
-        iptr = getNode(head, i);
-        for (j = i + 1; j < size; j++) {
-            jptr = getNode(head, j);
-            if (iptr->val > jptr->val) {
-                int temp = iptr->val;
-                iptr->val = jptr->val;
-                jptr->val = temp;
-            }
+/**
+ * Remove and return the top value of a heap
+ */
+int heapPop(heap *h) {
+    int retVal = h->vals[0];
+    int last = h->vals[--h->size];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= h->size) {
+            break;
+        }
+        if (child + 1 < h->size && heapBefore(h, h->vals[child + 1], h->vals[child])) {
+            child++;
+        }
+        if (!heapBefore(h, h->vals[child], last)) {
+            break;
         }
+        h->vals[i] = h->vals[child];
+        i = child;
+    }
+    if (h->size > 0) {
+        h->vals[i] = last;
     }
+    return retVal;
 }
 
-int main(void) {
-    int retVal = 0;
-    int scanResults;
-    node *nodeptr;
+/**
+ * Add a value to the running median and return the median of everything seen so far
+ * @param val : new value
+ * @return median as a float
+ */
+float runningMedian(int val) {
+    if (lowHalf.size == 0 || val <= lowHalf.vals[0]) {
+        heapPush(&lowHalf, val);
+    }
+    else {
+        heapPush(&highHalf, val);
+    }
+    // Rebalance so the low half has the same number of values as the high half, or one more
+    if (lowHalf.size > highHalf.size + 1) {
+        heapPush(&highHalf, heapPop(&lowHalf));
+    }
+    else if (highHalf.size > lowHalf.size) {
+        heapPush(&lowHalf, heapPop(&highHalf));
+    }
+
+    if (lowHalf.size > highHalf.size) {
+        return lowHalf.vals[0];
+    }
+    return (float) (lowHalf.vals[0] + highHalf.vals[0]) / 2;
+}
+
+/**
+ * Allocate a skiplist node with the given number of levels
+ */
+skipNode *buildSkipNode(int val, int levels) {
+    skipNode *retVal = malloc(sizeof(skipNode) + levels * (sizeof(skipNode *) + sizeof(int)));
+    if (retVal == NULL) {
+        fprintf(stderr, "Memory error\n");
+        exit(1);
+    }
+    retVal->val = val;
+    retVal->levels = levels;
+    retVal->next = (skipNode **) (retVal + 1);
+    retVal->width = (int *) (retVal->next + levels);
+    return retVal;
+}
 
-    // Create the linked list, read in first value
-    node *head = malloc(sizeof(node));
-    if (head == NULL) {
+/**
+ * Set up an empty skiplist and window of the given size
+ * @param size : number of values in the window
+ */
+void initWindow(int size) {
+    int i;
+    skipHead = buildSkipNode(0, SKIP_MAX_LEVELS);
+    for (i = 0; i < SKIP_MAX_LEVELS; i++) {
+        skipHead->next[i] = NULL;
+        skipHead->width[i] = 1;
+    }
+    skipLevels = 1;
+    skipSize = 0;
+    // Use as many levels as a skiplist of the window's size can make use of
+    while (skipLevels < SKIP_MAX_LEVELS && (1 << skipLevels) < size) {
+        skipLevels++;
+    }
+    window = malloc(size * sizeof(int));
+    if (window == NULL) {
         fprintf(stderr, "Memory error\n");
         exit(1);
     }
-    head->next = NULL;
+    windowSize = 0;
+    windowStart = 0;
+    srand(352);
+}
 
-    scanResults = scanf("%d", &head->val);
-    if (scanResults < 1) {
-        fprintf(stderr, "Error: first value wasn't an integer.\n");
+/**
+ * Insert a value into the skiplist
+ */
+void skipInsert(int val) {
+    skipNode *chain[SKIP_MAX_LEVELS];
+    int stepsAt[SKIP_MAX_LEVELS];
+    skipNode *node = skipHead;
+    int steps = 0;
+    int level;
+
+    // Find the last node at each level that's <= val, and its position
+    for (level = skipLevels - 1; level >= 0; level--) {
+        while (node->next[level] != NULL && node->next[level]->val <= val) {
+            steps += node->width[level];
+            node = node->next[level];
+        }
+        chain[level] = node;
+        stepsAt[level] = steps;
+    }
+
+    // Each extra level with probability 1/2
+    int levels = 1;
+    while (levels < skipLevels && (rand() & 1)) {
+        levels++;
+    }
+    skipNode *newNode = buildSkipNode(val, levels);
+    for (level = 0; level < levels; level++) {
+        skipNode *prev = chain[level];
+        newNode->next[level] = prev->next[level];
+        prev->next[level] = newNode;
+        newNode->width[level] = prev->width[level] - (steps - stepsAt[level]);
+        prev->width[level] = steps - stepsAt[level] + 1;
+    }
+    for (level = levels; level < skipLevels; level++) {
+        chain[level]->width[level]++;
+    }
+    skipSize++;
+}
+
+/**
+ * Remove one copy of a value from the skiplist
+ */
+void skipRemove(int val) {
+    skipNode *chain[SKIP_MAX_LEVELS];
+    skipNode *node = skipHead;
+    int level;
+
+    // skipLevels is always at least 1, so chain[0] is overwritten below
+    chain[0] = skipHead;
+    for (level = skipLevels - 1; level >= 0; level--) {
+        while (node->next[level] != NULL && node->next[level]->val < val) {
+            node = node->next[level];
+        }
+        chain[level] = node;
+    }
+    skipNode *target = chain[0]->next[0];
+    for (level = 0; level < target->levels; level++) {
+        chain[level]->width[level] += target->width[level] - 1;
+        chain[level]->next[level] = target->next[level];
+    }
+    for (level = target->levels; level < skipLevels; level++) {
+        chain[level]->width[level]--;
+    }
+    free(target);
+    skipSize--;
+}
+
+/**
+ * Get the value at a position in the skiplist's sorted order
+ * @param i : 0-based position
+ */
+int skipGet(int i) {
+    skipNode *node = skipHead;
+    int level;
+    i++;
+    for (level = skipLevels - 1; level >= 0; level--) {
+        while (node->next[level] != NULL && node->width[level] <= i) {
+            i -= node->width[level];
+            node = node->next[level];
+        }
+    }
+    return node->val;
+}
+
+/**
+ * Add a value to the window (dropping the oldest value if it's full) and return the median of the window
+ * @param val : new value
+ * @param size : size of the window
+ * @return median as a float
+ */
+float windowMedian(int val, int size) {
+    if (windowSize == size) {
+        skipRemove(window[windowStart]);
+        window[windowStart] = val;
+        windowStart = (windowStart + 1) % size;
+    }
+    else {
+        window[windowSize++] = val;
+    }
+    skipInsert(val);
+
+    if (skipSize % 2 == 1) {
+        return skipGet(skipSize / 2);
+    }
+    return (float) (skipGet(skipSize / 2 - 1) + skipGet(skipSize / 2)) / 2;
+}
+
+/**
+ * Free the skiplist and window
+ */
+void freeWindow() {
+    skipNode *node = skipHead;
+    while (node != NULL) {
+        skipNode *next = node->next[0];
+        free(node);
+        node = next;
+    }
+    free(window);
+}
+
+/**
+ * Handle one input value: store it, or print the new streaming median
+ * @param array : array to store values in when not streaming
+ * @param val : value read
+ * @param windowLength : -1 for no streaming, 0 for a running median, or the size of the window
+ */
+void addValue(intArray *array, int val, int windowLength) {
+    if (windowLength < 0) {
+        append(array, val);
+    }
+    else if (windowLength == 0) {
+        printf("%.1f\n", runningMedian(val));
+    }
+    else {
+        printf("%.1f\n", windowMedian(val, windowLength));
+    }
+}
+
+/*
+ * KLL quantile sketch. Level h holds values that each stand for 2^h input values. When the sketch is over capacity,
+ * the lowest full level is sorted and every other value (starting at a random one of the first two) is promoted to
+ * the next level; the rest are dropped. Lower levels get geometrically smaller capacities, so the whole sketch stays
+ * around 3 * KLL_K values. Two sketches merge by combining their levels and compacting the same way.
+ */
+#define KLL_K 200
+#define KLL_MAX_LEVELS 60
+#define MAX_QUANTILES 64
+
+typedef struct kllSketch {
+    intArray levels[KLL_MAX_LEVELS];
+    int numLevels;
+    long count;                 // number of input values
+    int size;                   // number of values held across all levels
+    int capacity;               // total of the level capacities
+    unsigned int randomState;
+} kllSketch;
+
+typedef struct sketchJob {
+    pthread_t thread;
+    char *filename;
+    kllSketch sketch;
+    int errors;
+} sketchJob;
+
+typedef struct weighted {
+    int val;
+    long weight;
+} weighted;
+
+/**
+ * Capacity of a level in a sketch with the given number of levels: KLL_K at the top, shrinking by 2/3 per level
+ * below it, but never less than 8
+ */
+int levelCapacity(int level, int numLevels) {
+    double capacity = KLL_K;
+    int depth = numLevels - 1 - level;
+    while (depth-- > 0 && capacity > 8) {
+        capacity = capacity * 2 / 3;
+    }
+    return capacity > 8 ? (int) (capacity + 0.999) : 8;
+}
+
+/**
+ * Compare ints for qsort
+ */
+int compareInts(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Recompute a sketch's total capacity after its number of levels changes
+ */
+void kllSetLevels(kllSketch *sketch, int numLevels) {
+    int level;
+    sketch->numLevels = numLevels;
+    sketch->capacity = 0;
+    for (level = 0; level < numLevels; level++) {
+        sketch->capacity += levelCapacity(level, numLevels);
+    }
+}
+
+/**
+ * Compact the lowest level that's at capacity until the sketch fits again
+ */
+void kllCompress(kllSketch *sketch) {
+    while (sketch->size > sketch->capacity) {
+        int level, i;
+        for (level = 0; level < sketch->numLevels; level++) {
+            if (sketch->levels[level].size >= levelCapacity(level, sketch->numLevels)) {
+                break;
+            }
+        }
+        if (level + 1 >= sketch->numLevels) {
+            if (sketch->numLevels == KLL_MAX_LEVELS) {
+                fprintf(stderr, "Error: too many values for the sketch.\n");
+                exit(1);
+            }
+            kllSetLevels(sketch, sketch->numLevels + 1);
+        }
+
+        // Promote every other value of the sorted level; an odd one out stays behind
+        intArray *from = &sketch->levels[level];
+        qsort(from->vals, from->size, sizeof(int), compareInts);
+        sketch->randomState = sketch->randomState * 1103515245u + 12345u;
+        int offset = (sketch->randomState >> 16) & 1;
+        int keep = from->size % 2;
+        for (i = keep + offset; i < from->size; i += 2) {
+            append(&sketch->levels[level + 1], from->vals[i]);
+        }
+        sketch->size -= (from->size - keep) / 2;
+        from->size = keep;
+    }
+}
+
+/**
+ * Add a value to a sketch
+ */
+void kllUpdate(kllSketch *sketch, int val) {
+    append(&sketch->levels[0], val);
+    sketch->count++;
+    if (++sketch->size > sketch->capacity) {
+        kllCompress(sketch);
+    }
+}
+
+/**
+ * Merge one sketch into another
+ * @param into : sketch that receives the values
+ * @param from : sketch to merge (left unchanged)
+ */
+void kllMerge(kllSketch *into, kllSketch *from) {
+    int level, i;
+    if (from->numLevels > into->numLevels) {
+        kllSetLevels(into, from->numLevels);
+    }
+    for (level = 0; level < from->numLevels; level++) {
+        for (i = 0; i < from->levels[level].size; i++) {
+            append(&into->levels[level], from->levels[level].vals[i]);
+        }
+    }
+    into->count += from->count;
+    into->size += from->size;
+    kllCompress(into);
+}
+
+/**
+ * Compare weighted values for qsort
+ */
+int compareWeighted(const void *a, const void *b) {
+    return compareInts(&((const weighted *) a)->val, &((const weighted *) b)->val);
+}
+
+/**
+ * Print the requested percentiles of a sketch
+ * @param sketch : sketch to query
+ * @param percents : percentiles, from 0 to 100
+ * @param numPercents : number of percentiles
+ */
+void printQuantiles(kllSketch *sketch, double *percents, int numPercents) {
+    int total = 0, n = 0, level, i, q;
+    for (level = 0; level < sketch->numLevels; level++) {
+        total += sketch->levels[level].size;
+    }
+    weighted *items = malloc((total > 0 ? total : 1) * sizeof(weighted));
+    if (items == NULL) {
+        fprintf(stderr, "Memory error\n");
         exit(1);
     }
+    long totalWeight = 0;
+    for (level = 0; level < sketch->numLevels; level++) {
+        for (i = 0; i < sketch->levels[level].size; i++) {
+            items[n].val = sketch->levels[level].vals[i];
+            items[n].weight = 1L << level;
+            totalWeight += items[n++].weight;
+        }
+    }
+    qsort(items, n, sizeof(weighted), compareWeighted);
+
+    for (q = 0; q < numPercents; q++) {
+        // The first value whose cumulative weight reaches the requested rank
+        double rank = percents[q] / 100 * totalWeight;
+        long cumulative = 0;
+        for (i = 0; i < n - 1; i++) {
+            cumulative += items[i].weight;
+            if (cumulative >= rank) {
+                break;
+            }
+        }
+        printf("p%g %d\n", percents[q], items[i].val);
+    }
+    free(items);
+}
+
+/**
+ * Read every integer in a file into a job's sketch, stopping with an error at anything that isn't an integer
+ * @param arg : the sketchJob
+ */
+void *sketchFile(void *arg) {
+    sketchJob *job = arg;
+    intReader reader;
+    int fd = STDIN_FILENO;
+    int val, scanResults;
+
+    if (job->filename != NULL) {
+        fd = open(job->filename, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error opening file %s.\n", job->filename);
+            job->errors++;
+            return NULL;
+        }
+    }
+    initReader(&reader, fd);
+    while ((scanResults = readInt(&reader, &val)) != EOF) {
+        if (scanResults == 0) {
+            fprintf(stderr, "Error: didn't read an integer in %s. Using what was input.\n",
+                    job->filename != NULL ? job->filename : "stdin");
+            job->errors++;
+            break;
+        }
+        kllUpdate(&job->sketch, val);
+    }
+    freeReader(&reader);
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return NULL;
+}
+
+/**
+ * Sketch mode: main() for "-q [-p P]... [file]..."
+ */
+int sketchMain(int argc, char **argv) {
+    double percents[MAX_QUANTILES];
+    int numPercents = 0;
+    int argi = 2;
+    int errors = 0;
+    int i, level;
+
+    while (argi + 1 < argc && strcmp(argv[argi], "-p") == 0) {
+        char *end;
+        double percent = strtod(argv[argi + 1], &end);
+        if (*end != '\0' || percent < 0 || percent > 100 || numPercents == MAX_QUANTILES) {
+            fprintf(stderr, "Error: -p must be followed by a percentile from 0 to 100.\n");
+            exit(1);
+        }
+        percents[numPercents++] = percent;
+        argi += 2;
+    }
+    if (numPercents == 0) {
+        percents[0] = 50;
+        percents[1] = 90;
+        percents[2] = 99;
+        numPercents = 3;
+    }
 
-    // Keep adding to the linked list until EOF reached
-    nodeptr = head;
-    node *newNode = malloc(sizeof(node));
-    if (newNode == NULL) {
+    // One job per file, or one for stdin
+    int numJobs = argc - argi > 0 ? argc - argi : 1;
+    sketchJob *jobs = calloc(numJobs, sizeof(sketchJob));
+    if (jobs == NULL) {
         fprintf(stderr, "Memory error\n");
         exit(1);
     }
-    newNode->next = NULL;
+    for (i = 0; i < numJobs; i++) {
+        jobs[i].filename = argi + i < argc ? argv[argi + i] : NULL;
+        kllSetLevels(&jobs[i].sketch, 1);
+        jobs[i].sketch.randomState = 352 + i;
+    }
+    for (i = 1; i < numJobs; i++) {
+        if (pthread_create(&jobs[i].thread, NULL, sketchFile, &jobs[i]) != 0) {
+            fprintf(stderr, "Error: couldn't create thread.\n");
+            exit(1);
+        }
+    }
+    sketchFile(&jobs[0]);
+    for (i = 1; i < numJobs; i++) {
+        pthread_join(jobs[i].thread, NULL);
+        kllMerge(&jobs[0].sketch, &jobs[i].sketch);
+    }
+
+    for (i = 0; i < numJobs; i++) {
+        errors += jobs[i].errors;
+    }
+    if (jobs[0].sketch.count == 0) {
+        fprintf(stderr, "Error: no integers were read.\n");
+        exit(1);
+    }
+    printQuantiles(&jobs[0].sketch, percents, numPercents);
+
+    for (i = 0; i < numJobs; i++) {
+        for (level = 0; level < KLL_MAX_LEVELS; level++) {
+            free(jobs[i].sketch.levels[level].vals);
+        }
+    }
+    free(jobs);
+    return errors > 0;
+}
+
+int main(int argc, char **argv) {
+    int retVal = 0;
+    int scanResults;
+    int val;
+    intArray array = {NULL, 0, 0};
+    intReader reader;
+
+    // -1: read everything then print one median; 0: running median; otherwise the window size
+    int windowLength = -1;
+    if (argc >= 2 && strcmp(argv[1], "-q") == 0) {
+        return sketchMain(argc, argv);
+    }
+    if (argc == 2 && strcmp(argv[1], "-s") == 0) {
+        windowLength = 0;
+    }
+    else if (argc == 3 && strcmp(argv[1], "-w") == 0) {
+        char *end;
+        windowLength = (int) strtol(argv[2], &end, 10);
+        if (*end != '\0' || windowLength <= 0) {
+            fprintf(stderr, "Error: -w must be followed by a positive window size.\n");
+            exit(1);
+        }
+        initWindow(windowLength);
+    }
+    else if (argc != 1) {
+        fprintf(stderr, "Error: the only options are -s, -w N and -q.\n");
+        exit(1);
+    }
+
+    // Read in first value
+    initReader(&reader, STDIN_FILENO);
+    scanResults = readInt(&reader, &val);
+    if (scanResults < 1) {
+        fprintf(stderr, "Error: first value wasn't an integer.\n");
+        exit(1);
+    }
+    addValue(&array, val, windowLength);
 
-    while ((scanResults = scanf("%d", &newNode->val)) != EOF) {
+    // Keep adding values until EOF reached
+    while ((scanResults = readInt(&reader, &val)) != EOF) {
         //Indicate errors if needed
         if (scanResults == 0) {
             fprintf(stderr, "Error: didn't read an integer. Finding median of what was input.\n");
@@ -126,23 +799,21 @@ int main(void) {
             break;
         }
         else {
-            // Add newNode to the linked list
-            nodeptr->next = newNode;
-            nodeptr = newNode;
-        }
-
-        // malloc a new node for the next iteration
-        newNode = malloc(sizeof(node));
-        if (newNode == NULL) {
-            fprintf(stderr, "Memory error\n");
-            exit(1);
+            addValue(&array, val, windowLength);
         }
-        newNode->next = NULL;
     }
 
-    // Sort and then find the median
-    sortList(head);
-    printf("%.1f\n", computeMedian(head));
+    // Find the median
+    if (windowLength < 0) {
+        printf("%.1f\n", computeMedian(&array));
+    }
+    else if (windowLength > 0) {
+        freeWindow();
+    }
+    freeReader(&reader);
+    free(array.vals);
+    free(lowHalf.vals);
+    free(highHalf.vals);
 
     return (retVal > 0);
 }
\ No newline at end of file
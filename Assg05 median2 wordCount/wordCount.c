@@ -4,22 +4,131 @@
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
  * Purpose: Reads in text from stdin, processes each word slightly, and displays a count of each word present
+ * Optional command-line args (before an optional filename to read instead of stdin):
+ *   -k N    print only the N most frequent words, most frequent first
+ *   -t N    count with N threads: the input is mapped (or read in large chunks from stdin), split at whitespace,
+ *           counted into a table per thread, and the tables are merged at the end
+ *   -a KB   approximate counting in a fixed memory budget of about KB kilobytes, for streams with too many distinct
+ *           words to keep. Prints the top words (10, or N with -k) as "word lower upper", where the true count is
+ *           guaranteed to be between lower and upper, followed by a HyperLogLog estimate of the number of
+ *           distinct words and the Count-Min error bound.
+ *   -o FILE write the counted words to FILE as a binary snapshot instead of printing them
+ *   -m      merge mode: the remaining arguments are snapshot files (from -o), which are merged with a streaming
+ *           k-way merge and printed like a normal count (or written to another snapshot with -o)
  */
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 typedef struct word {
     char *str;
     int count;
+    unsigned int hash;
     struct word *next;
 } word;
 
-// Define a global list head to save on # of parameters needed for functions
+/*
+ * Words are found through an open-addressing hash table, and also kept in a linked list (in the order they were
+ * first seen) for sorting and printing. Their strings are interned into large shared blocks rather than being
+ * malloc'ed one at a time.
+ */
+#define STRING_BLOCK_SIZE 65536
+
+typedef struct stringBlock {
+    struct stringBlock *next;
+    size_t used;
+    size_t size;
+    char data[1];
+} stringBlock;
+
+typedef struct table {
+    word **slots;
+    int capacity;       // always a power of 2
+    int numWords;
+    word *head;
+    word *tail;
+    stringBlock *strings;
+} table;
+
+// Define a global table to save on # of parameters needed for functions
+table words;
 word *head;
 
+#define READ_CHUNK (1 << 24)
+
+// Byte classes for the tokenizer (isspace/isalpha in the C locale)
+#define CLASS_OTHER 0
+#define CLASS_SPACE 1
+#define CLASS_LETTER 2
+
+unsigned char byteClass[256];
+
+// Reusable buffer a word is normalized into before it's counted
+typedef struct wordBuffer {
+    char *text;
+    size_t length;
+    size_t capacity;
+} wordBuffer;
+
+/*
+ * Approximate counting: a Count-Min sketch bounds every word's count from above, a Space-Saving summary tracks the
+ * heaviest words (each with a guaranteed lower bound), and a HyperLogLog sketch estimates the number of distinct words.
+ */
+#define CM_DEPTH 4
+#define HLL_BITS 14
+#define HLL_REGISTERS (1 << HLL_BITS)
+
+typedef struct heavyHitter {
+    char *str;
+    long count;         // upper bound on the true count
+    long error;         // count - error is a lower bound
+    unsigned long hash;
+    int heapIndex;
+} heavyHitter;
+
+int approximate = 0;
+unsigned int *cmCounts;             // CM_DEPTH rows of cmWidth counters
+unsigned long cmWidth;              // power of 2
+heavyHitter *hitters;
+heavyHitter **hitterHeap;           // min-heap on count, so the root is the one to evict
+int *hitterSlots;                   // open-addressing index of hitters by word, -1 if empty
+int hitterCap, hitterSlotCap, numHitters;
+unsigned char hllRegisters[HLL_REGISTERS];
+long totalWords;
+
+/*
+ * Snapshots: "WCSNAP1\n", then one entry per word in sorted order, then an entry with both lengths 0. Each entry is
+ * the length of the prefix it shares with the previous word, the length of the rest, the rest, and the count, with
+ * the numbers as base-128 varints.
+ */
+#define SNAPSHOT_MAGIC "WCSNAP1\n"
+
+typedef struct snapshot {
+    FILE *file;
+    char *name;
+    char *word;             // current word
+    size_t length;
+    size_t capacity;
+    unsigned long count;    // current word's count
+} snapshot;
+
+typedef struct countJob {
+    pthread_t thread;
+    char *start;
+    char *end;
+    table counts;
+} countJob;
+
 /**
  * Print out all strings and their counts in the linked list
  */
@@ -32,195 +141,1190 @@ void printList() {
 }
 
 /**
- * Add a string to the list of words. If it's already present, increase the count by 1. Otherwise, add a new node
- * @param newWord : string to add to the list
+ * FNV-1a hash of a string
  */
-void add(char *newWord) {
-    if (strcmp(head->str, "\0") == 0) {
-        head->count = 1;
-        head->str = malloc(strlen(newWord) + 1);
-        if (head->str == NULL) {
+unsigned int hashString(char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str) * 16777619u;
+        str++;
+    }
+    return hash;
+}
+
+/**
+ * Copy a string into the table's string blocks, starting a new block when the current one is full
+ * @param t : table that owns the strings
+ * @param str : string to copy
+ * @return pointer to the interned copy
+ */
+char *intern(table *t, char *str) {
+    size_t length = strlen(str) + 1;
+    stringBlock *block = t->strings;
+    if (block == NULL || block->used + length > block->size) {
+        size_t size = length > STRING_BLOCK_SIZE ? length : STRING_BLOCK_SIZE;
+        block = malloc(sizeof(stringBlock) + size);
+        if (block == NULL) {
             fprintf(stderr, "Memory error.\n");
             exit(1);
         }
-        strcpy(head->str, newWord);
-        head->next = NULL;
-        return;
+        block->used = 0;
+        block->size = size;
+        block->next = t->strings;
+        t->strings = block;
+    }
+    char *retVal = block->data + block->used;
+    memcpy(retVal, str, length);
+    block->used += length;
+    return retVal;
+}
+
+/**
+ * Put a word into the table's slots, assuming there's room and it isn't already there
+ */
+void insertSlot(table *t, word *w) {
+    int slot = (int) (w->hash & (unsigned int) (t->capacity - 1));
+    while (t->slots[slot] != NULL) {
+        slot = (slot + 1) & (t->capacity - 1);
+    }
+    t->slots[slot] = w;
+}
+
+/**
+ * Double the number of slots in a table and re-insert every word
+ */
+void growTable(table *t) {
+    word *cur;
+    free(t->slots);
+    t->capacity = t->capacity == 0 ? 1024 : t->capacity * 2;
+    t->slots = calloc(t->capacity, sizeof(word *));
+    if (t->slots == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    for (cur = t->head; cur != NULL; cur = cur->next) {
+        insertSlot(t, cur);
+    }
+}
+
+/**
+ * Add a string to a table of words. If it's already present, increase the count. Otherwise, add a new node
+ * @param t : table to add to
+ * @param newWord : string to add
+ * @param count : how many times it was seen
+ */
+void addCount(table *t, char *newWord, int count) {
+    unsigned int hash = hashString(newWord);
+    if (t->capacity > 0) {
+        int slot = (int) (hash & (unsigned int) (t->capacity - 1));
+        while (t->slots[slot] != NULL) {
+            if (t->slots[slot]->hash == hash && strcmp(t->slots[slot]->str, newWord) == 0) {
+                t->slots[slot]->count += count;
+                return;
+            }
+            slot = (slot + 1) & (t->capacity - 1);
+        }
+    }
+
+    // Not found: create a new node with newWord as the string and connect it to the end of the list
+    word *newNode = malloc(sizeof(word));
+    if (newNode == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    newNode->str = intern(t, newWord);
+    newNode->count = count;
+    newNode->hash = hash;
+    newNode->next = NULL;
+    if (t->tail == NULL) {
+        t->head = newNode;
+    }
+    else {
+        t->tail->next = newNode;
+    }
+    t->tail = newNode;
+    t->numWords++;
+
+    // Keep the table no more than half full
+    if (2 * t->numWords > t->capacity) {
+        growTable(t);
+    }
+    else {
+        insertSlot(t, newNode);
+    }
+}
+
+/**
+ * Copy the nodes of a table's list into a newly allocated array
+ * @param t : table to copy from
+ * @return array of t->numWords node pointers
+ */
+word **toArray(table *t) {
+    word **retVal = malloc((t->numWords > 0 ? t->numWords : 1) * sizeof(word *));
+    if (retVal == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    int i = 0;
+    word *cur;
+    for (cur = t->head; cur != NULL; cur = cur->next) {
+        retVal[i++] = cur;
+    }
+    return retVal;
+}
+
+/**
+ * Merge-sort an array of words alphabetically. Runs are merged bottom-up, back and forth between the array and a
+ * scratch array of the same size, so every pass is a sequential sweep over memory.
+ * @param array : words to sort
+ * @param size : number of words
+ */
+void mergeSort(word **array, int size) {
+    word **scratch = malloc((size > 0 ? size : 1) * sizeof(word *));
+    if (scratch == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    word **from = array;
+    word **to = scratch;
+    int width, i;
+
+    for (width = 1; width < size; width *= 2) {
+        for (i = 0; i < size; i += 2 * width) {
+            int left = i;
+            int mid = i + width < size ? i + width : size;
+            int right = i + 2 * width < size ? i + 2 * width : size;
+            int a = left, b = mid, k = left;
+            while (a < mid && b < right) {
+                // Take from the left run on ties to keep the sort stable
+                if (strcmp(from[b]->str, from[a]->str) < 0) {
+                    to[k++] = from[b++];
+                }
+                else {
+                    to[k++] = from[a++];
+                }
+            }
+            while (a < mid) {
+                to[k++] = from[a++];
+            }
+            while (b < right) {
+                to[k++] = from[b++];
+            }
+        }
+        word **temp = from;
+        from = to;
+        to = temp;
+    }
+    if (from != array) {
+        memcpy(array, from, size * sizeof(word *));
+    }
+    free(scratch);
+}
+
+/**
+ * Sort the linked list of words alphabetically by merge-sorting an array of the nodes and relinking them
+ */
+void sortList() {
+    word **array = toArray(&words);
+    int i;
+
+    mergeSort(array, words.numWords);
+    for (i = 0; i < words.numWords; i++) {
+        array[i]->next = i + 1 < words.numWords ? array[i + 1] : NULL;
+    }
+    if (words.numWords > 0) {
+        words.head = array[0];
+        words.tail = array[words.numWords - 1];
+    }
+    head = words.head;
+    free(array);
+}
+
+/**
+ * Check whether word a ranks below word b in the top-k order: lower count, or the same count and later alphabetically
+ */
+int ranksBelow(word *a, word *b) {
+    if (a->count != b->count) {
+        return a->count < b->count;
     }
-    word *curNode = head;
-    // Loop through the list. If newWord is found anywhere, increase that node's count and return
-    while (curNode->next != NULL) {
-        // Compare to this node
-        if (strcmp(curNode->str, newWord) == 0) {
-            curNode->count++;
+    return strcmp(a->str, b->str) > 0;
+}
+
+/**
+ * Restore the heap property of a min-heap (lowest-ranked word at the root) by moving element i down
+ * @param heap : heap array
+ * @param size : number of elements in the heap
+ * @param i : index to sift down
+ */
+void siftDown(word **heap, int size, int i) {
+    while (1) {
+        int lowest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < size && ranksBelow(heap[left], heap[lowest])) {
+            lowest = left;
+        }
+        if (right < size && ranksBelow(heap[right], heap[lowest])) {
+            lowest = right;
+        }
+        if (lowest == i) {
             return;
         }
-        else {
-            curNode = curNode->next;
+        word *temp = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = temp;
+        i = lowest;
+    }
+}
+
+/**
+ * Print the k most frequent words, most frequent first (ties alphabetically), keeping only k words in a min-heap
+ * instead of sorting everything
+ * @param k : number of words to print
+ */
+void printTopK(int k) {
+    word **heap = malloc((k > 0 ? k : 1) * sizeof(word *));
+    if (heap == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    int size = 0;
+    int i;
+    word *cur;
+
+    for (cur = words.head; cur != NULL; cur = cur->next) {
+        if (size < k) {
+            // Still filling the heap: sift the new word up
+            i = size++;
+            heap[i] = cur;
+            while (i > 0 && ranksBelow(heap[i], heap[(i - 1) / 2])) {
+                word *temp = heap[i];
+                heap[i] = heap[(i - 1) / 2];
+                heap[(i - 1) / 2] = temp;
+                i = (i - 1) / 2;
+            }
+        }
+        else if (k > 0 && ranksBelow(heap[0], cur)) {
+            heap[0] = cur;
+            siftDown(heap, size, 0);
+        }
+    }
+
+    // Pop the lowest-ranked word off repeatedly, filling the array from the back so the best ends up first
+    int count = size;
+    while (size > 0) {
+        word *lowest = heap[0];
+        heap[0] = heap[--size];
+        siftDown(heap, size, 0);
+        heap[size] = lowest;
+    }
+    for (i = 0; i < count; i++) {
+        printf("%s %d\n", heap[i]->str, heap[i]->count);
+    }
+    free(heap);
+}
+
+/**
+ * Free the nodes, slots and string blocks of a table
+ * @param t : table to free
+ */
+void freeTable(table *t) {
+    word *temp = t->head;
+    while (temp != NULL) {
+        word *next = temp->next;
+        free(temp);
+        temp = next;
+    }
+    while (t->strings != NULL) {
+        stringBlock *next = t->strings->next;
+        free(t->strings);
+        t->strings = next;
+    }
+    free(t->slots);
+    memset(t, 0, sizeof(table));
+}
+
+/**
+ * Free the nodes (and strings) of the word table
+ */
+void freeAll(){
+    freeTable(&words);
+    head = NULL;
+}
+
+/**
+ * 64-bit FNV-1a hash of a string, with a final mix so all bits are usable
+ */
+unsigned long long hashString64(char *str) {
+    unsigned long long hash = 14695981039346656037ULL;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str) * 1099511628211ULL;
+        str++;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * Size and allocate the sketches to fit roughly in a memory budget
+ * @param budgetKb : budget in kilobytes
+ * @param topK : number of heavy hitters that will be reported
+ */
+void approxInit(long budgetKb, int topK) {
+    int i;
+    // Half the budget goes to Space-Saving (guessing 16 bytes per word), and at least several times more candidates
+    // than are reported are tracked. Any word seen more than totalWords / hitterCap times is guaranteed to be tracked.
+    long perHitter = sizeof(heavyHitter) + sizeof(heavyHitter *) + 2 * sizeof(int) + 16;
+    hitterCap = (int) (budgetKb * 1024 / 2 / perHitter);
+    if (hitterCap < topK * 8) {
+        hitterCap = topK * 8;
+    }
+    if (hitterCap < 64) {
+        hitterCap = 64;
+    }
+    hitterSlotCap = 1;
+    while (hitterSlotCap < 2 * hitterCap) {
+        hitterSlotCap *= 2;
+    }
+    long hitterBytes = (long) hitterCap * perHitter;
+
+    // Count-Min gets the rest of the budget, rounded down to a power of 2 per row
+    long cmBytes = budgetKb * 1024 - hitterBytes - HLL_REGISTERS;
+    cmWidth = 256;
+    while ((long) (cmWidth * 2 * CM_DEPTH * sizeof(unsigned int)) <= cmBytes) {
+        cmWidth *= 2;
+    }
+
+    cmCounts = calloc(cmWidth * CM_DEPTH, sizeof(unsigned int));
+    hitters = calloc(hitterCap, sizeof(heavyHitter));
+    hitterHeap = malloc(hitterCap * sizeof(heavyHitter *));
+    hitterSlots = malloc(hitterSlotCap * sizeof(int));
+    if (cmCounts == NULL || hitters == NULL || hitterHeap == NULL || hitterSlots == NULL) {
+        fprintf(stderr, "Memory error.\n");
+        exit(1);
+    }
+    for (i = 0; i < hitterSlotCap; i++) {
+        hitterSlots[i] = -1;
+    }
+    memset(hllRegisters, 0, sizeof(hllRegisters));
+    numHitters = 0;
+    totalWords = 0;
+}
+
+/**
+ * Find the slot a heavy hitter's word occupies (or would occupy) in the index
+ */
+int findHitterSlot(char *str, unsigned long hash) {
+    int slot = (int) (hash & (unsigned long) (hitterSlotCap - 1));
+    while (hitterSlots[slot] != -1) {
+        heavyHitter *h = &hitters[hitterSlots[slot]];
+        if (h->hash == hash && strcmp(h->str, str) == 0) {
+            return slot;
         }
+        slot = (slot + 1) & (hitterSlotCap - 1);
     }
-    // Reached the end of the list. Do one last comparison to see if it's a match
-    if (strcmp(curNode->str, newWord) == 0) {
-        curNode->count++;
+    return slot;
+}
+
+/**
+ * Remove a slot from the heavy hitter index, shifting later entries of the probe run back so lookups still work
+ */
+void removeHitterSlot(int slot) {
+    int next = (slot + 1) & (hitterSlotCap - 1);
+    hitterSlots[slot] = -1;
+    while (hitterSlots[next] != -1) {
+        int entry = hitterSlots[next];
+        int home = (int) (hitters[entry].hash & (unsigned long) (hitterSlotCap - 1));
+        // Move the entry into the hole if the hole lies between its home slot and where it is now
+        if (((next - home) & (hitterSlotCap - 1)) >= ((next - slot) & (hitterSlotCap - 1))) {
+            hitterSlots[slot] = entry;
+            hitterSlots[next] = -1;
+            slot = next;
+        }
+        next = (next + 1) & (hitterSlotCap - 1);
+    }
+}
+
+/**
+ * Move a heavy hitter up the min-heap while its count is below its parent's
+ */
+void hitterSiftUp(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (hitterHeap[parent]->count <= hitterHeap[i]->count) {
+            return;
+        }
+        heavyHitter *temp = hitterHeap[i];
+        hitterHeap[i] = hitterHeap[parent];
+        hitterHeap[parent] = temp;
+        hitterHeap[i]->heapIndex = i;
+        hitterHeap[parent]->heapIndex = parent;
+        i = parent;
+    }
+}
+
+/**
+ * Move a heavy hitter down the min-heap after its count went up
+ */
+void hitterSiftDown(int i) {
+    while (1) {
+        int lowest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < numHitters && hitterHeap[left]->count < hitterHeap[lowest]->count) {
+            lowest = left;
+        }
+        if (right < numHitters && hitterHeap[right]->count < hitterHeap[lowest]->count) {
+            lowest = right;
+        }
+        if (lowest == i) {
+            return;
+        }
+        heavyHitter *temp = hitterHeap[i];
+        hitterHeap[i] = hitterHeap[lowest];
+        hitterHeap[lowest] = temp;
+        hitterHeap[i]->heapIndex = i;
+        hitterHeap[lowest]->heapIndex = lowest;
+        i = lowest;
+    }
+}
+
+/**
+ * Record one occurrence of a word in all three sketches
+ * @param str : normalized word
+ */
+void approxAdd(char *str) {
+    unsigned long long hash = hashString64(str);
+    unsigned long h1 = (unsigned long) hash;
+    unsigned long h2 = (unsigned long) (hash >> 32) | 1;
+    int row;
+
+    totalWords++;
+
+    // Count-Min: one counter per row, picked by double hashing
+    for (row = 0; row < CM_DEPTH; row++) {
+        unsigned int *counter = &cmCounts[row * cmWidth + ((h1 + row * h2) & (cmWidth - 1))];
+        if (*counter != 0xFFFFFFFFu) {
+            (*counter)++;
+        }
+    }
+
+    // HyperLogLog: the top bits pick a register, which keeps the longest run of leading zeros seen in the rest
+    int reg = (int) (hash >> (64 - HLL_BITS));
+    unsigned long long rest = (hash << HLL_BITS) | (1ULL << (HLL_BITS - 1));
+    int rank = __builtin_clzll(rest) + 1;
+    if (rank > hllRegisters[reg]) {
+        hllRegisters[reg] = (unsigned char) rank;
+    }
+
+    // Space-Saving: count a tracked word, start tracking a new one, or replace the smallest tracked word
+    int slot = findHitterSlot(str, h1);
+    heavyHitter *h;
+    if (hitterSlots[slot] != -1) {
+        h = &hitters[hitterSlots[slot]];
+        h->count++;
+        hitterSiftDown(h->heapIndex);
         return;
     }
-        // If not, create a new node with newWord as the string
+    if (numHitters < hitterCap) {
+        h = &hitters[numHitters];
+        h->count = 1;
+        h->error = 0;
+        h->heapIndex = numHitters;
+        hitterHeap[numHitters++] = h;
+        hitterSiftUp(h->heapIndex);
+    }
     else {
-        word *newNode = malloc(sizeof(word));
-        if (newNode == NULL) {
-            fprintf(stderr, "Memory error.\n");
-            exit(1);
+        h = hitterHeap[0];
+        removeHitterSlot(findHitterSlot(h->str, h->hash));
+        slot = findHitterSlot(str, h1);
+        free(h->str);
+        h->error = h->count;
+        h->count++;
+    }
+    h->str = strdup(str);
+    h->hash = h1;
+    hitterSlots[slot] = (int) (h - hitters);
+    hitterSiftDown(h->heapIndex);
+}
+
+/**
+ * Count-Min estimate of a word's count: the smallest of its counters
+ */
+long cmEstimate(unsigned long long hash) {
+    unsigned long h1 = (unsigned long) hash;
+    unsigned long h2 = (unsigned long) (hash >> 32) | 1;
+    long retVal = -1;
+    int row;
+    for (row = 0; row < CM_DEPTH; row++) {
+        long value = cmCounts[row * cmWidth + ((h1 + row * h2) & (cmWidth - 1))];
+        if (retVal < 0 || value < retVal) {
+            retVal = value;
+        }
+    }
+    return retVal;
+}
+
+/**
+ * Order heavy hitters by upper bound (highest first), then alphabetically
+ */
+int compareHitters(const void *a, const void *b) {
+    heavyHitter *x = *(heavyHitter **) a;
+    heavyHitter *y = *(heavyHitter **) b;
+    if (x->count != y->count) {
+        return x->count > y->count ? -1 : 1;
+    }
+    return strcmp(x->str, y->str);
+}
+
+/**
+ * Print the top words with their bounds, the distinct word estimate, and the Count-Min error bound, then free
+ * the sketches
+ * @param topK : number of words to print
+ */
+void approxReport(int topK) {
+    int i;
+    qsort(hitterHeap, numHitters, sizeof(heavyHitter *), compareHitters);
+    for (i = 0; i < numHitters && i < topK; i++) {
+        heavyHitter *h = hitterHeap[i];
+        // Both sketches overestimate, so the tighter of the two is still an upper bound
+        long upper = h->count;
+        long cm = cmEstimate(hashString64(h->str));
+        if (cm < upper) {
+            upper = cm;
         }
+        printf("%s %ld %ld\n", h->str, h->count - h->error, upper);
+    }
+
+    // HyperLogLog estimate, with linear counting for small cardinalities
+    double sum = 0;
+    int zeros = 0;
+    for (i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hllRegisters[i]);
+        zeros += hllRegisters[i] == 0;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    printf("distinct words: about %.0f (standard error %.1f%%)\n", estimate, 104.0 / sqrt(m));
+    printf("total words: %ld; any count above may be at most %.0f too high with probability %.3f\n", totalWords,
+           exp(1.0) / cmWidth * totalWords, 1 - exp(-(double) CM_DEPTH));
 
-        // Fill in the new node, connect it to the end of the list
-        newNode->count = 1;
+    for (i = 0; i < numHitters; i++) {
+        free(hitters[i].str);
+    }
+    free(hitters);
+    free(hitterHeap);
+    free(hitterSlots);
+    free(cmCounts);
+}
 
-        newNode->str = malloc(strlen(newWord) + 1);
-        if (newNode->str == NULL) {
+/**
+ * Fill in the byte class table
+ */
+void buildByteClasses() {
+    int c;
+    for (c = 0; c < 256; c++) {
+        byteClass[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ? CLASS_LETTER :
+                       c == ' ' || (c >= '\t' && c <= '\r') ? CLASS_SPACE : CLASS_OTHER;
+    }
+}
+
+/**
+ * Make sure a word buffer has room for 'extra' more characters plus a terminator
+ */
+void reserveWord(wordBuffer *buf, size_t extra) {
+    if (buf->length + extra + 1 > buf->capacity) {
+        while (buf->length + extra + 1 > buf->capacity) {
+            buf->capacity = buf->capacity == 0 ? 256 : buf->capacity * 2;
+        }
+        buf->text = realloc(buf->text, buf->capacity);
+        if (buf->text == NULL) {
             fprintf(stderr, "Memory error.\n");
             exit(1);
         }
-        strcpy(newNode->str, newWord);
-
-        newNode->next = NULL;
-        curNode->next = newNode;
     }
 }
 
 /**
- * Get the node at index i of a linked list
- * @param i : index to retrieve
- * @return pointer to that node
+ * Count the word collected in a buffer (if it has any letters) and empty the buffer
  */
-word *getNode(int i) {
-    int count = 0;
-    word *retVal = head;
-    while (count < i) {
-        retVal = retVal->next;
-        count++;
+void flushWord(table *t, wordBuffer *buf) {
+    if (buf->length > 0) {
+        buf->text[buf->length] = '\0';
+        if (approximate) {
+            approxAdd(buf->text);
+        }
+        else {
+            addCount(t, buf->text, 1);
+        }
+        buf->length = 0;
     }
-    return retVal;
 }
 
 /**
- * Bubble-sort the items in a linked list of word objects
+ * Count the words in a block of text. Words are separated by whitespace; within a word, letters are lowercased and
+ * everything else is dropped (which also strips leading and trailing non-letters), and words with no letters are
+ * skipped. The text is classified 16 bytes at a time with SSE2 when it's available, and words are normalized into
+ * one reusable buffer, so there is no per-word allocation and no limit on word length.
+ * @param t : table to count into
+ * @param ptr : start of the text, which must not be in the middle of a word
+ * @param end : end of the text, which must be at whitespace or the end of the input
+ * @param buf : reusable word buffer
  */
-void sortList() {
-    word *iptr, *jptr;
+void countText(table *t, const char *ptr, const char *end, wordBuffer *buf) {
+#ifdef __SSE2__
+    const __m128i letterBias = _mm_set1_epi8((char) (0x80 - 'a'));
+    const __m128i letterLimit = _mm_set1_epi8((char) (0x80 + 26));
+    const __m128i spaceBias = _mm_set1_epi8((char) (0x80 - '\t'));
+    const __m128i spaceLimit = _mm_set1_epi8((char) (0x80 + 5));
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    char lowered[16];
 
-    // Find the size of the linked list
-    int size = 0;
-    iptr = head;
-    while (iptr != NULL) {
-        size++;
-        iptr = iptr->next;
-    }
-
-    // Sort the linked list using a simple bubble sort
-    int i, j;
-    for (i = 0; i < size - 1; i++) {
-        iptr = getNode(i);
-        for (j = i + 1; j < size; j++) {
-            jptr = getNode(j);
-            if (strcmp(iptr->str, jptr->str) > 0) {
-                int tempCount = iptr->count;
-                char *tempString = iptr->str;
-                iptr->str = jptr->str;
-                iptr->count = jptr->count;
-                jptr->str = tempString;
-                jptr->count = tempCount;
+    while (end - ptr >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) ptr);
+        // (c | 0x20) - 'a' < 26 for letters and c - '\t' < 5 for \t..\r, as signed compares on biased bytes
+        __m128i folded = _mm_or_si128(block, caseBit);
+        __m128i letters = _mm_cmplt_epi8(_mm_add_epi8(folded, letterBias), letterLimit);
+        __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(block, blank),
+                                      _mm_cmplt_epi8(_mm_add_epi8(block, spaceBias), spaceLimit));
+        int letterMask = _mm_movemask_epi8(letters);
+        int spaceMask = _mm_movemask_epi8(spaces);
+
+        if (letterMask == 0xFFFF) {
+            // All letters: append the whole block at once
+            reserveWord(buf, 16);
+            _mm_storeu_si128((__m128i *) (buf->text + buf->length), folded);
+            buf->length += 16;
+        }
+        else if ((letterMask | spaceMask) != 0) {
+            // Visit only the letters and spaces; everything else is dropped
+            int mask = letterMask | spaceMask;
+            _mm_storeu_si128((__m128i *) lowered, _mm_or_si128(block, _mm_and_si128(letters, caseBit)));
+            reserveWord(buf, 16);
+            while (mask != 0) {
+                int i = __builtin_ctz(mask);
+                if (spaceMask & (1 << i)) {
+                    flushWord(t, buf);
+                    reserveWord(buf, 16);
+                }
+                else {
+                    buf->text[buf->length++] = lowered[i];
+                }
+                mask &= mask - 1;
             }
         }
+        ptr += 16;
     }
+#endif
+    // Whatever is left (or everything, without SSE2) one byte at a time
+    while (ptr < end) {
+        unsigned char c = (unsigned char) *ptr++;
+        if (byteClass[c] == CLASS_LETTER) {
+            reserveWord(buf, 1);
+            buf->text[buf->length++] = (char) (c | 0x20);
+        }
+        else if (byteClass[c] == CLASS_SPACE) {
+            flushWord(t, buf);
+        }
+    }
+    flushWord(t, buf);
 }
 
 /**
- * Free the nodes (and strings) of the linked list
+ * Count the words in part of the input into a job's own table
+ * @param arg : the countJob
  */
-void freeAll(){
-    word *temp = malloc(sizeof(word));
-    if(temp == NULL){
-        fprintf(stderr, "Memory error\n");
+void *countWords(void *arg) {
+    countJob *job = arg;
+    wordBuffer buf;
+    memset(&buf, 0, sizeof(buf));
+    countText(&job->counts, job->start, job->end, &buf);
+    free(buf.text);
+    return NULL;
+}
+
+/**
+ * Count every word in a file (or stdin) on this thread, reading it in large blocks. A word cut off at the end of a
+ * block is moved to the front of the buffer and finished with the next read.
+ * @param fileptr : input
+ */
+void countSerial(FILE *fileptr) {
+    size_t capacity = READ_CHUNK;
+    size_t filled = 0;
+    ssize_t got;
+    wordBuffer buf;
+    char *data = malloc(capacity);
+    if (data == NULL) {
+        fprintf(stderr, "Memory error.\n");
         exit(1);
     }
+    memset(&buf, 0, sizeof(buf));
 
-    temp = head;
-    while(head != NULL){
-        head = head->next;
-        free(temp->str);
-        free(temp);
-        temp = head;
+    while ((got = read(fileno(fileptr), data + filled, capacity - filled)) > 0) {
+        filled += got;
+        char *last = data + filled;
+        while (last > data && byteClass[(unsigned char) last[-1]] != CLASS_SPACE) {
+            last--;
+        }
+        if (last == data) {
+            // One word fills the whole buffer: make room for more of it
+            if (filled == capacity) {
+                capacity *= 2;
+                data = realloc(data, capacity);
+                if (data == NULL) {
+                    fprintf(stderr, "Memory error.\n");
+                    exit(1);
+                }
+            }
+            continue;
+        }
+        countText(&words, data, last, &buf);
+        filled = data + filled - last;
+        memmove(data, last, filled);
     }
+    countText(&words, data, data + filled, &buf);
+    head = words.head;
+    free(buf.text);
+    free(data);
 }
 
 /**
- * Convert all letters to lowercase and remove leading and trailing numbers and special characters
- * @param string
+ * Count every word in a file (or stdin) with several threads and merge their tables into the global one
+ * @param fileptr : input
+ * @param numThreads : number of threads
  */
-char *process(char *string) {
-    char *newWord = malloc(strlen(string) * sizeof(char) + 1);
-    if (newWord == NULL) {
+void countParallel(FILE *fileptr, int numThreads) {
+    struct stat info;
+    char *data = NULL;
+    size_t size = 0;
+    int mapped = 0;
+    int i;
+
+    // Map regular files; read anything else in large chunks
+    if (fstat(fileno(fileptr), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(fileptr), 0);
+        if (data != MAP_FAILED) {
+            size = info.st_size;
+            mapped = 1;
+            madvise(data, size, MADV_SEQUENTIAL);
+        }
+    }
+    if (!mapped) {
+        size_t capacity = 0;
+        ssize_t got;
+        data = NULL;
+        do {
+            if (capacity - size < READ_CHUNK) {
+                capacity = capacity == 0 ? 2 * READ_CHUNK : capacity * 2;
+                data = realloc(data, capacity);
+                if (data == NULL) {
+                    fprintf(stderr, "Memory error.\n");
+                    exit(1);
+                }
+            }
+            got = read(fileno(fileptr), data + size, capacity - size);
+            if (got > 0) {
+                size += got;
+            }
+        } while (got > 0);
+    }
+
+    // Split into roughly equal pieces, moving each boundary forward to the next whitespace
+    countJob *jobs = calloc(numThreads, sizeof(countJob));
+    if (jobs == NULL) {
         fprintf(stderr, "Memory error.\n");
         exit(1);
     }
+    char *cursor = data;
+    for (i = 0; i < numThreads; i++) {
+        char *end = i == numThreads - 1 ? data + size : data + size / numThreads * (i + 1);
+        if (end < cursor) {
+            end = cursor;
+        }
+        while (end < data + size && byteClass[(unsigned char) *end] != CLASS_SPACE) {
+            end++;
+        }
+        jobs[i].start = cursor;
+        jobs[i].end = end;
+        cursor = end;
+    }
 
-    char *sptr = string;
-    char *nptr = newWord;
-    char *lastLetter = newWord;
+    for (i = 1; i < numThreads; i++) {
+        if (pthread_create(&jobs[i].thread, NULL, countWords, &jobs[i]) != 0) {
+            fprintf(stderr, "Error: couldn't create thread.\n");
+            exit(1);
+        }
+    }
+    countWords(&jobs[0]);
+    for (i = 1; i < numThreads; i++) {
+        pthread_join(jobs[i].thread, NULL);
+    }
 
-    // Skip leading non-alphabetical characters
-    while (!isalpha(*sptr) && *sptr != '\0') {
-        sptr++;
+    // Merge every thread's table into the global one
+    for (i = 0; i < numThreads; i++) {
+        word *cur;
+        for (cur = jobs[i].counts.head; cur != NULL; cur = cur->next) {
+            addCount(&words, cur->str, cur->count);
+        }
+        freeTable(&jobs[i].counts);
     }
-    // Deal with empty string
-    if (*sptr == '\0') {
-        *newWord = '\0';
+    head = words.head;
+    free(jobs);
+
+    if (mapped) {
+        munmap(data, size);
     }
     else {
-        // Process all letters and keep track of last letter to remove trailing special characters
-        while (*sptr != '\0') {
-            if (isalpha(*sptr)) {
-                *nptr = tolower(*sptr);
-                lastLetter = nptr;
-                nptr++;
-            }
-            sptr++;
+        free(data);
+    }
+}
+
+
+/**
+ * Write a number as a base-128 varint
+ */
+void writeVarint(FILE *out, unsigned long value) {
+    while (value >= 0x80) {
+        putc((int) (value & 0x7F) | 0x80, out);
+        value >>= 7;
+    }
+    putc((int) value, out);
+}
+
+/**
+ * Read a base-128 varint
+ * @return 1 on success, 0 at a truncated or corrupt number
+ */
+int readVarint(FILE *in, unsigned long *value) {
+    int shift = 0, c;
+    *value = 0;
+    while ((c = getc(in)) != EOF && shift < 64) {
+        *value |= (unsigned long) (c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return 1;
         }
-        // Remove trailing special characters by null-terminating after the last letter seen.
-        *(lastLetter + 1) = '\0';
+        shift += 7;
     }
-    return newWord;
+    return 0;
 }
 
+/**
+ * Append one word to a snapshot, front-coded against the previous word
+ * @param out : snapshot file
+ * @param prev : previous word written ("" for the first)
+ * @param str : word to write, which must sort after prev
+ * @param count : its count
+ */
+void writeEntry(FILE *out, char *prev, char *str, unsigned long count) {
+    size_t shared = 0;
+    while (prev[shared] != '\0' && prev[shared] == str[shared]) {
+        shared++;
+    }
+    size_t rest = strlen(str + shared);
+    writeVarint(out, shared);
+    writeVarint(out, rest);
+    fwrite(str + shared, 1, rest, out);
+    writeVarint(out, count);
+}
 
-int main(void) {
-    // Create the first node
-    head = malloc(sizeof(word));
-    if (head == NULL) {
+/**
+ * Open a snapshot file for writing and write its header
+ */
+FILE *createSnapshot(char *filename) {
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Error opening file %s.\n", filename);
+        exit(1);
+    }
+    fputs(SNAPSHOT_MAGIC, out);
+    return out;
+}
+
+/**
+ * Write the end marker and close a snapshot
+ */
+void finishSnapshot(FILE *out, char *filename) {
+    writeVarint(out, 0);
+    writeVarint(out, 0);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error writing file %s.\n", filename);
+        exit(1);
+    }
+}
+
+/**
+ * Write the (sorted) word list to a snapshot file
+ * @param filename : file to write
+ */
+void saveSnapshot(char *filename) {
+    FILE *out = createSnapshot(filename);
+    char *prev = "";
+    word *cur;
+    for (cur = words.head; cur != NULL; cur = cur->next) {
+        writeEntry(out, prev, cur->str, cur->count);
+        prev = cur->str;
+    }
+    finishSnapshot(out, filename);
+}
+
+/**
+ * Move a snapshot on to its next word
+ * @return 1 if there is one, 0 at the end of the snapshot
+ */
+int nextEntry(snapshot *snap) {
+    unsigned long shared, rest;
+    if (!readVarint(snap->file, &shared) || !readVarint(snap->file, &rest) || shared > snap->length) {
+        fprintf(stderr, "Error: %s is not a valid snapshot.\n", snap->name);
+        exit(1);
+    }
+    if (shared == 0 && rest == 0) {
+        return 0;
+    }
+    if (shared + rest + 1 > snap->capacity) {
+        snap->capacity = 2 * (shared + rest + 1);
+        snap->word = realloc(snap->word, snap->capacity);
+        if (snap->word == NULL) {
+            fprintf(stderr, "Memory error.\n");
+            exit(1);
+        }
+    }
+    if (fread(snap->word + shared, 1, rest, snap->file) != rest || !readVarint(snap->file, &snap->count)) {
+        fprintf(stderr, "Error: %s is not a valid snapshot.\n", snap->name);
+        exit(1);
+    }
+    snap->length = shared + rest;
+    snap->word[snap->length] = '\0';
+    return 1;
+}
+
+/**
+ * Restore the heap property of a min-heap of snapshots (ordered by current word) by moving element i down
+ */
+void snapshotSiftDown(snapshot **heap, int size, int i) {
+    while (1) {
+        int lowest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < size && strcmp(heap[left]->word, heap[lowest]->word) < 0) {
+            lowest = left;
+        }
+        if (right < size && strcmp(heap[right]->word, heap[lowest]->word) < 0) {
+            lowest = right;
+        }
+        if (lowest == i) {
+            return;
+        }
+        snapshot *temp = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = temp;
+        i = lowest;
+    }
+}
+
+/**
+ * Merge sorted snapshots with a k-way merge, adding up the counts of words that appear in more than one. Only one
+ * word per snapshot is held in memory. The result is printed like a normal count, or written to a snapshot.
+ * @param filenames : snapshot files to merge
+ * @param numFiles : number of files
+ * @param outName : snapshot file to write, or NULL to print
+ */
+void mergeSnapshots(char **filenames, int numFiles, char *outName) {
+    snapshot *snaps = calloc(numFiles, sizeof(snapshot));
+    snapshot **heap = malloc(numFiles * sizeof(snapshot *));
+    char magic[8];
+    int size = 0;
+    int i;
+    if (snaps == NULL || heap == NULL) {
         fprintf(stderr, "Memory error.\n");
         exit(1);
     }
-    head->str = "\0";
-    head->count = 0;
-    head->next = NULL;
 
-    // Flag to prevent sorting and printing an empty list
-    int wordsAdded = 0;
+    for (i = 0; i < numFiles; i++) {
+        snaps[i].name = filenames[i];
+        snaps[i].file = fopen(filenames[i], "rb");
+        if (snaps[i].file == NULL) {
+            fprintf(stderr, "Error opening file %s.\n", filenames[i]);
+            exit(1);
+        }
+        setvbuf(snaps[i].file, NULL, _IOFBF, 1 << 20);
+        if (fread(magic, 1, 8, snaps[i].file) != 8 || memcmp(magic, SNAPSHOT_MAGIC, 8) != 0) {
+            fprintf(stderr, "Error: %s is not a valid snapshot.\n", filenames[i]);
+            exit(1);
+        }
+        if (nextEntry(&snaps[i])) {
+            heap[size++] = &snaps[i];
+        }
+    }
+    for (i = size / 2 - 1; i >= 0; i--) {
+        snapshotSiftDown(heap, size, i);
+    }
 
-    // Read in strings, process them, add them to the list until EOF reached, unless they're empty when processed
-    char buff[129];
-    while (scanf("%128s", buff) != EOF) {
-        char *newWord = process(buff);
-        if (strlen(newWord) > 0) {
-            add(newWord);
-            wordsAdded = 1;
+    FILE *out = outName != NULL ? createSnapshot(outName) : NULL;
+    char *prev = NULL;
+    size_t prevCap = 0;
+    int first = 1;
+    while (size > 0) {
+        // Remember the smallest word, then add up every snapshot's count for it
+        size_t length = heap[0]->length;
+        if (length + 1 > prevCap) {
+            prevCap = 2 * (length + 1);
+            prev = realloc(prev, prevCap);
+            if (prev == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        char *entry = malloc(length + 1);
+        if (entry == NULL) {
+            fprintf(stderr, "Memory error.\n");
+            exit(1);
         }
+        memcpy(entry, heap[0]->word, length + 1);
+        unsigned long total = 0;
+        while (size > 0 && strcmp(heap[0]->word, entry) == 0) {
+            total += heap[0]->count;
+            if (!nextEntry(heap[0])) {
+                heap[0] = heap[--size];
+            }
+            snapshotSiftDown(heap, size, 0);
+        }
+
+        if (out != NULL) {
+            writeEntry(out, first ? "" : prev, entry, total);
+        }
+        else {
+            printf("%s %lu\n", entry, total);
+        }
+        memcpy(prev, entry, length + 1);
+        first = 0;
+        free(entry);
+    }
+    if (out != NULL) {
+        finishSnapshot(out, outName);
+    }
+
+    for (i = 0; i < numFiles; i++) {
+        fclose(snaps[i].file);
+        free(snaps[i].word);
+    }
+    free(prev);
+    free(snaps);
+    free(heap);
+}
+
+int main(int argc, char **argv) {
+    memset(&words, 0, sizeof(table));
+    head = NULL;
+
+    // -k N switches to top-k output, -t N to threaded counting, -a KB to approximate counting, -o FILE to writing
+    // a snapshot, and -m to merging snapshots
+    int topK = -1;
+    int numThreads = 0;
+    long budgetKb = 0;
+    char *snapshotName = NULL;
+    int merge = 0;
+    int argi = 1;
+    while (argi < argc && argv[argi][0] == '-') {
+        if (strcmp(argv[argi], "-m") == 0) {
+            merge = 1;
+            argi++;
+            continue;
+        }
+        if ((strcmp(argv[argi], "-k") != 0 && strcmp(argv[argi], "-t") != 0 && strcmp(argv[argi], "-a") != 0 &&
+             strcmp(argv[argi], "-o") != 0) || argi + 1 >= argc) {
+            fprintf(stderr, "Error: options are -k N, -t N, -a KB, -o FILE and -m, followed by filenames.\n");
+            exit(1);
+        }
+        if (argv[argi][1] == 'o') {
+            snapshotName = argv[argi + 1];
+            argi += 2;
+            continue;
+        }
+        char *end;
+        long value = strtol(argv[argi + 1], &end, 10);
+        if (*end != '\0' || value < 0 || (argv[argi][1] != 'k' && value == 0)) {
+            fprintf(stderr, "Error: %s must be followed by a %s number.\n", argv[argi],
+                    argv[argi][1] != 'k' ? "positive" : "non-negative");
+            exit(1);
+        }
+        if (argv[argi][1] == 'k') {
+            topK = (int) value;
+        }
+        else if (argv[argi][1] == 't') {
+            numThreads = (int) value;
+        }
+        else {
+            budgetKb = value;
+            approximate = 1;
+        }
+        argi += 2;
     }
+    if (approximate && (numThreads > 0 || snapshotName != NULL)) {
+        fprintf(stderr, "Error: -a can't be used with -t or -o.\n");
+        exit(1);
+    }
+    if (merge) {
+        if (topK >= 0 || numThreads > 0 || approximate || argi >= argc) {
+            fprintf(stderr, "Error: -m takes one or more snapshot files and only the -o option.\n");
+            exit(1);
+        }
+        mergeSnapshots(argv + argi, argc - argi, snapshotName);
+        return 0;
+    }
+    FILE *fileptr = stdin;
+    if (argi < argc) {
+        if (argi + 1 < argc) {
+            fprintf(stderr, "Error: only one filename allowed.\n");
+            exit(1);
+        }
+        fileptr = fopen(argv[argi], "r");
+        if (fileptr == NULL) {
+            fprintf(stderr, "Error opening file %s.\n", argv[argi]);
+            exit(1);
+        }
+    }
+
+    // Flag to prevent sorting and printing an empty list
+    int wordsAdded;
 
-    if (wordsAdded != 0) {
-        // Sort and print the list
+    // Read in words, process them, and count them until EOF reached, unless they're empty when processed
+    buildByteClasses();
+    if (approximate) {
+        approxInit(budgetKb, topK >= 0 ? topK : 10);
+    }
+    if (numThreads > 0) {
+        countParallel(fileptr, numThreads);
+    }
+    else {
+        countSerial(fileptr);
+    }
+    wordsAdded = words.numWords > 0;
+    if (fileptr != stdin) {
+        fclose(fileptr);
+    }
+
+    if (approximate) {
+        approxReport(topK >= 0 ? topK : 10);
+    }
+    else if (snapshotName != NULL) {
         sortList();
-        printList();
+        saveSnapshot(snapshotName);
+    }
+    else if (wordsAdded != 0) {
+        if (topK >= 0) {
+            printTopK(topK);
+        }
+        else {
+            // Sort and print the list
+            sortList();
+            printList();
+        }
     }
     // Free memory
     freeAll();
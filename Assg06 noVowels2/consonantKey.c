@@ -0,0 +1,49 @@
+/*
+ * File: consonantKey.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Turns a word into its consonant key: its letters lowercased with the vowels removed. Two words match with
+ *          the vowels removed exactly when their keys are equal. A 256-entry table classifies each byte, so the loop
+ *          does one lookup per character and no comparisons; consonants are always stored and only advance the
+ *          output when they should be kept.
+ */
+
+#include "consonantKey.h"
+
+/*
+ * For each byte: 0 if it isn't a letter, 1 if it's a vowel, otherwise the lowercase consonant
+ */
+static unsigned char keyTable[256];
+
+/**
+ * Fill in the byte class table. Must be called before consonantKey().
+ */
+void initKeyTable() {
+    int c;
+    for (c = 'a'; c <= 'z'; c++) {
+        int isVowel = c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+        keyTable[c] = (unsigned char) (isVowel ? 1 : c);
+        keyTable[c - 'a' + 'A'] = keyTable[c];
+    }
+}
+
+/**
+ * Write a word's consonant key
+ * @param word : word to make a key for
+ * @param key : buffer with room for a copy of word
+ * @return length of the key, or -1 if the word contains anything other than letters
+ */
+int consonantKey(const char *word, char *key) {
+    const unsigned char *ptr = (const unsigned char *) word;
+    int length = 0;
+    int bad = 0;
+    for (; *ptr != '\0'; ptr++) {
+        unsigned char c = keyTable[*ptr];
+        key[length] = (char) c;
+        length += c > 1;
+        bad |= c == 0;
+    }
+    key[length] = '\0';
+    return bad ? -1 : length;
+}
@@ -0,0 +1,20 @@
+/*
+ * File: consonantKey.h
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Header file for consonantKey.c, which strips the vowels out of a word in one table-driven pass
+ */
+
+#ifndef _CONSONANTKEY_H
+#define _CONSONANTKEY_H
+
+/*
+ * Public Functions
+ */
+
+void initKeyTable();
+
+int consonantKey(const char *word, char *key);
+
+#endif
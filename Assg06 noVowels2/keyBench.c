@@ -0,0 +1,111 @@
+/*
+ * File: keyBench.c
+ *
+ * Author: Alex Swindle (aswindle@email.arizona.edu)
+ *
+ * Purpose: Microbenchmark for consonantKey(). Reads a word list (such as a dictionary) from stdin, then times building
+ *          every word's key the old way (isalpha check, tolower, and five vowel comparisons per character) against
+ *          the table-driven kernel, checks that both give the same keys, and prints the time per word of each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include "consonantKey.h"
+
+#define REPEATS 20
+
+/**
+ * Wall clock time in seconds
+ */
+double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * The key the way noVowels and noVowels2 used to compute it
+ * @return length of the key, or -1 if the word contains anything other than letters
+ */
+int oldKey(const char *word, char *key) {
+    int length = 0;
+    const char *ptr;
+    for (ptr = word; *ptr != '\0'; ptr++) {
+        if (!isalpha(*ptr)) {
+            return -1;
+        }
+        char c = tolower(*ptr);
+        if (c != 'a' && c != 'e' && c != 'i' && c != 'o' && c != 'u') {
+            key[length++] = c;
+        }
+    }
+    key[length] = '\0';
+    return length;
+}
+
+int main(void) {
+    char buff[65];
+    char **words = NULL;
+    int numWords = 0, capacity = 0;
+    int i, rep;
+    long oldTotal = 0, newTotal = 0;
+    char oldBuff[65], newBuff[65];
+
+    // Read in the word list
+    while (scanf("%64s", buff) != EOF) {
+        if (numWords == capacity) {
+            capacity = capacity == 0 ? 1024 : capacity * 2;
+            words = realloc(words, capacity * sizeof(char *));
+            if (words == NULL) {
+                fprintf(stderr, "Memory error.\n");
+                exit(1);
+            }
+        }
+        words[numWords++] = strdup(buff);
+    }
+    if (numWords == 0) {
+        fprintf(stderr, "Error: no words were read.\n");
+        exit(1);
+    }
+    initKeyTable();
+
+    // Both versions must agree before timing them means anything
+    for (i = 0; i < numWords; i++) {
+        int oldLength = oldKey(words[i], oldBuff);
+        int newLength = consonantKey(words[i], newBuff);
+        if (oldLength != newLength || (oldLength >= 0 && strcmp(oldBuff, newBuff) != 0)) {
+            fprintf(stderr, "Error: keys differ for %s.\n", words[i]);
+            exit(1);
+        }
+    }
+
+    double startTime = now();
+    for (rep = 0; rep < REPEATS; rep++) {
+        for (i = 0; i < numWords; i++) {
+            oldTotal += oldKey(words[i], oldBuff) + oldBuff[0];
+        }
+    }
+    double oldTime = now() - startTime;
+
+    startTime = now();
+    for (rep = 0; rep < REPEATS; rep++) {
+        for (i = 0; i < numWords; i++) {
+            newTotal += consonantKey(words[i], newBuff) + newBuff[0];
+        }
+    }
+    double newTime = now() - startTime;
+
+    printf("%d words, %d passes\n", numWords, REPEATS);
+    printf("tolower + compares: %.1f ns/word\n", oldTime * 1e9 / ((double) numWords * REPEATS));
+    printf("consonantKey:       %.1f ns/word\n", newTime * 1e9 / ((double) numWords * REPEATS));
+
+    for (i = 0; i < numWords; i++) {
+        free(words[i]);
+    }
+    free(words);
+    // Using the totals keeps the timed loops from being optimized away
+    return oldTotal != newTotal;
+}
@@ -4,12 +4,23 @@
  * Author: Alex Swindle (aswindle@email.arizona.edu)
  *
  * Purpose: Reads from stdin and prints out groups of words that match when the vowels are removed
+ * Optional command-line args:
+ *   -t N [file]   read the whole input (the file, or stdin) at once, split it among N threads that each group their
+ *                 share of the words, then merge the groups. Output is the same as the default mode, except words
+ *                 longer than 64 characters are kept whole instead of being split up.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "consonantKey.h"
+
+#define READ_CHUNK (1 << 24)
 
 /**
  * One node of a linked list of strings
@@ -20,13 +31,41 @@ typedef struct stringNode {
 } stringNode;
 
 /**
- * One node of a linked list of groups of strings
+ * One node of a linked list of groups of strings. Every word in a group has the same key: its letters lowercased with
+ * the vowels removed.
  */
 typedef struct groupNode {
+    char *key;
+    unsigned int hash;
     struct stringNode *strings;
+    struct stringNode *tail;
     struct groupNode *next;
 } groupNode;
 
+/**
+ * Open-addressing hash table of groups by key, so each word finds its group without comparing against every other
+ * group. The groups are also kept in a linked list in the order they were first seen, which is the order they print.
+ * The first group in the list holds an empty string and catches all words that are only vowels.
+ */
+typedef struct groupTable {
+    groupNode **slots;
+    int capacity;
+    int numGroups;
+    groupNode *head;
+    groupNode *tail;
+} groupTable;
+
+/**
+ * One thread's share of the input in -t mode
+ */
+typedef struct groupJob {
+    pthread_t thread;
+    char *start;
+    char *end;
+    groupTable groups;
+    int errors;
+} groupJob;
+
 /**
  * Print out an error and exit in the event a malloc fails
  */
@@ -36,49 +75,15 @@ void memError() {
 }
 
 /**
- * RE-USED FROM ASSG2
- * Returns whether 2 strings have matching consonants (will check lowercase version of strings)
- * Assumes they only contain alphabetical characters
- * @param a: first string
- * @param b: second string
- * @return 1 if the two strings match with vowels removed, 0 otherwise
- */
-int matchConsonants(char a[], char b[]) {
-    // Track current location in both strings
-    int aPos = 0;
-    int bPos = 0;
-    // Track current character in both strings
-    char aChar = tolower(a[aPos]);
-    char bChar = tolower(b[bPos]);
-    while (aChar != '\0' || bChar != '\0') {
-        // Increment aPos to skip over vowels
-        if (aChar == 'a' || aChar == 'e' || aChar == 'i' || aChar == 'o' || aChar == 'u') {
-            aPos++;
-        }
-            // Increment bPos to skip over vowels
-        else if (bChar == 'a' || bChar == 'e' || bChar == 'i' || bChar == 'o' || bChar == 'u') {
-            bPos++;
-        }
-            // Actually compare the two characters if neither is a vowel
-        else {
-            //Increment both positions, if not currently at the end
-            if (aChar != '\0') {
-                aPos++;
-            }
-            if (bChar != '\0') {
-                bPos++;
-            }
-            // If any two characters don't match, the whole strings don't match
-            if (aChar != bChar) {
-                return 0;
-            }
-        }
-
-        // Read next characters
-        aChar = tolower(a[aPos]);
-        bChar = tolower(b[bPos]);
+ * FNV-1a hash of a string
+ */
+unsigned int hashString(char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str) * 16777619u;
+        str++;
     }
-    return 1;
+    return hash;
 }
 
 /**
@@ -99,65 +104,135 @@ stringNode *buildStringNode(char *word) {
 }
 
 /**
- * Returns whether a string contains only alphabetical characters
- * @param word : string to check
- * @return 1 if only letters, 0 otherwise
+ * Put a group into a table's slots, assuming there's room and it isn't already there
  */
-int isLegal(char *word) {
-    char *ptr;
-    for (ptr = word; *ptr != '\0'; ptr++) {
-        if (!isalpha(*ptr)) {
-            return 0;
-        }
+void insertSlot(groupTable *t, groupNode *group) {
+    int slot = (int) (group->hash & (unsigned int) (t->capacity - 1));
+    while (t->slots[slot] != NULL) {
+        slot = (slot + 1) & (t->capacity - 1);
     }
-    return 1;
+    t->slots[slot] = group;
 }
 
 /**
- * Add a string to the linked list of groupNodes
- * If it matches one of the existing nodes' strings, add it to that list
- * Otherwise, create a new node and store the string there
- * @param word : string to add
- * @param head : head of linked list of groupNodes
- */
-void add(char *word, groupNode *head) {
-    groupNode *gptr = head;
-    while (gptr->next != NULL) {
-        // Add to an existing list of string if a match is found
-        if (matchConsonants(word, gptr->strings->string)) {
-            stringNode *sptr = gptr->strings;
-            while (sptr->next != NULL) {
-                sptr = sptr->next;
+ * Double the number of slots in a table and re-insert every group
+ */
+void growTable(groupTable *t) {
+    groupNode *gptr;
+    free(t->slots);
+    t->capacity = t->capacity == 0 ? 1024 : t->capacity * 2;
+    t->slots = calloc(t->capacity, sizeof(groupNode *));
+    if (t->slots == NULL) {
+        memError();
+    }
+    for (gptr = t->head; gptr != NULL; gptr = gptr->next) {
+        insertSlot(t, gptr);
+    }
+}
+
+/**
+ * Find the group with a key, creating an empty one at the end of the list if there isn't one yet
+ * @param t : table to look in
+ * @param key : consonant key
+ * @param hash : hash of the key
+ * @return the group
+ */
+groupNode *findGroup(groupTable *t, char *key, unsigned int hash) {
+    if (t->capacity > 0) {
+        int slot = (int) (hash & (unsigned int) (t->capacity - 1));
+        while (t->slots[slot] != NULL) {
+            if (t->slots[slot]->hash == hash && strcmp(t->slots[slot]->key, key) == 0) {
+                return t->slots[slot];
             }
-            sptr->next = buildStringNode(word);
-            return;
-        }
-            // Continue to the next node if not
-        else {
-            gptr = gptr->next;
+            slot = (slot + 1) & (t->capacity - 1);
         }
     }
-    // At the end of the list. Check again to see if it matches the last one
-    if (matchConsonants(word, gptr->strings->string)) {
-        stringNode *sptr = gptr->strings;
-        while (sptr->next != NULL) {
-            sptr = sptr->next;
-        }
-        sptr->next = buildStringNode(word);
-        return;
+
+    // Add a new group to the end of the list
+    groupNode *newGroup = malloc(sizeof(groupNode));
+    if (newGroup == NULL) {
+        memError();
+    }
+    newGroup->key = strdup(key);
+    newGroup->hash = hash;
+    newGroup->strings = NULL;
+    newGroup->tail = NULL;
+    newGroup->next = NULL;
+    if (t->tail == NULL) {
+        t->head = newGroup;
+    }
+    else {
+        t->tail->next = newGroup;
+    }
+    t->tail = newGroup;
+    t->numGroups++;
+
+    // Keep the table no more than half full
+    if (2 * t->numGroups > t->capacity) {
+        growTable(t);
+    }
+    else {
+        insertSlot(t, newGroup);
+    }
+    return newGroup;
+}
+
+/**
+ * Set up an empty table whose first group holds an empty string
+ */
+void initTable(groupTable *t) {
+    t->slots = NULL;
+    t->capacity = 0;
+    t->numGroups = 0;
+    t->head = NULL;
+    t->tail = NULL;
+    groupNode *blank = findGroup(t, "", hashString(""));
+    blank->strings = buildStringNode("");
+    blank->tail = blank->strings;
+}
+
+/**
+ * Add a string to a table
+ * If its key matches an existing group's key, add it to the end of that group
+ * Otherwise, create a new group at the end of the list and store the string there
+ * @param t : table to add to
+ * @param word : string to add
+ * @param key : the word's consonant key
+ */
+void add(groupTable *t, char *word, char *key) {
+    groupNode *group = findGroup(t, key, hashString(key));
+    stringNode *newNode = buildStringNode(word);
+    if (group->tail == NULL) {
+        group->strings = newNode;
     }
-        // Add a new node to the end of the list
     else {
-        groupNode *newGroup = malloc(sizeof(groupNode));
-        if (newGroup == NULL) {
-            memError();
+        group->tail->next = newNode;
+    }
+    group->tail = newNode;
+}
+
+/**
+ * Move every group of one table to the end of the matching groups in another, keeping first-seen order
+ * @param into : table that receives the words
+ * @param from : table to empty out; its slots and group nodes are freed
+ */
+void mergeTable(groupTable *into, groupTable *from) {
+    groupNode *gptr = from->head;
+    while (gptr != NULL) {
+        groupNode *next = gptr->next;
+        groupNode *group = findGroup(into, gptr->key, gptr->hash);
+        if (group->tail == NULL) {
+            group->strings = gptr->strings;
         }
         else {
-            newGroup->strings = buildStringNode(word);
-            newGroup->next = NULL;
-            gptr->next = newGroup;
+            group->tail->next = gptr->strings;
         }
+        group->tail = gptr->tail;
+        free(gptr->key);
+        free(gptr);
+        gptr = next;
     }
+    free(from->slots);
 }
 
 /**
@@ -185,36 +260,205 @@ void printAll(groupNode *head) {
     }
 }
 
-int main(void) {
-    int retVal = 0;
+/**
+ * Group the words between a job's start and end
+ * Words are split at whitespace the same way scanf("%s") does, but may be any length
+ * @param arg : the groupJob
+ */
+void *groupWords(void *arg) {
+    groupJob *job = arg;
+    char *pos = job->start;
+    char *word = NULL;
+    char *key = NULL;
+    size_t capacity = 0;
 
-    groupNode *head = malloc(sizeof(groupNode));
-    if (head == NULL) {
-        memError();
-        exit(1);
+    initTable(&job->groups);
+    while (1) {
+        while (pos < job->end && isspace((unsigned char) *pos)) {
+            pos++;
+        }
+        if (pos == job->end) {
+            break;
+        }
+        char *wordStart = pos;
+        while (pos < job->end && !isspace((unsigned char) *pos)) {
+            pos++;
+        }
+        size_t length = pos - wordStart;
+        if (length + 1 > capacity) {
+            capacity = 2 * (length + 1);
+            free(word);
+            free(key);
+            word = malloc(capacity);
+            key = malloc(capacity);
+            if (word == NULL || key == NULL) {
+                memError();
+            }
+        }
+        memcpy(word, wordStart, length);
+        word[length] = '\0';
+        if (consonantKey(word, key) >= 0) {
+            add(&job->groups, word, key);
+        }
+        else {
+            job->errors++;
+        }
+    }
+    free(word);
+    free(key);
+    return NULL;
+}
+
+/**
+ * Read all of a file: map it if it's a regular file, otherwise read it into a growing buffer
+ * @param fd : file descriptor to read
+ * @param size : set to the number of bytes
+ * @param mapped : set to 1 if the data was mapped and needs munmap() rather than free()
+ * @return the data
+ */
+char *readAll(int fd, size_t *size, int *mapped) {
+    struct stat info;
+    char *data = NULL;
+    size_t capacity = 0;
+    ssize_t got;
+
+    *size = 0;
+    *mapped = 0;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            *size = info.st_size;
+            *mapped = 1;
+            madvise(data, *size, MADV_SEQUENTIAL);
+            return data;
+        }
+        data = NULL;
     }
-    head->strings = malloc(sizeof(stringNode));
-    if (head->strings == NULL) {
+    do {
+        if (capacity - *size < READ_CHUNK) {
+            capacity = capacity == 0 ? 2 * READ_CHUNK : capacity * 2;
+            data = realloc(data, capacity);
+            if (data == NULL) {
+                memError();
+            }
+        }
+        got = read(fd, data + *size, capacity - *size);
+        if (got > 0) {
+            *size += got;
+        }
+    } while (got > 0);
+    return data;
+}
+
+/**
+ * Group all of the input with several threads
+ * @param fd : file descriptor to read
+ * @param numThreads : number of threads
+ * @param groups : table to fill with the merged groups
+ * @return number of words that weren't all letters
+ */
+int groupParallel(int fd, int numThreads, groupTable *groups) {
+    size_t size;
+    int mapped;
+    int errors = 0;
+    int i;
+    char *data = readAll(fd, &size, &mapped);
+
+    // Split into roughly equal pieces, moving each boundary forward to the next whitespace
+    groupJob *jobs = calloc(numThreads, sizeof(groupJob));
+    if (jobs == NULL) {
         memError();
     }
-    // First node will hold an empty string, which will also catch all words that are only vowels
-    head->strings->string = "";
-    head->strings->next = NULL;
-    head->next = NULL;
+    char *cursor = data;
+    for (i = 0; i < numThreads; i++) {
+        char *end = i == numThreads - 1 ? data + size : data + size / numThreads * (i + 1);
+        if (end < cursor) {
+            end = cursor;
+        }
+        while (end < data + size && !isspace((unsigned char) *end)) {
+            end++;
+        }
+        jobs[i].start = cursor;
+        jobs[i].end = end;
+        cursor = end;
+    }
 
-    char buff[65];
-    while (scanf("%64s", buff) != EOF) {
-        if (isLegal(buff)) {
-            add(buff, head);
+    for (i = 1; i < numThreads; i++) {
+        if (pthread_create(&jobs[i].thread, NULL, groupWords, &jobs[i]) != 0) {
+            fprintf(stderr, "Error: couldn't create thread.\n");
+            exit(1);
         }
-        else {
+    }
+    groupWords(&jobs[0]);
+    for (i = 1; i < numThreads; i++) {
+        pthread_join(jobs[i].thread, NULL);
+    }
+
+    // The pieces are in input order, so merging them in order keeps groups and words in order of first appearance
+    *groups = jobs[0].groups;
+    errors = jobs[0].errors;
+    for (i = 1; i < numThreads; i++) {
+        mergeTable(groups, &jobs[i].groups);
+        errors += jobs[i].errors;
+    }
+    free(jobs);
+
+    if (mapped) {
+        munmap(data, size);
+    }
+    else {
+        free(data);
+    }
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    int retVal = 0;
+    groupTable groups;
+    initKeyTable();
+
+    if (argc > 1) {
+        // -t N [file]
+        char *end;
+        int numThreads = argc >= 3 ? (int) strtol(argv[2], &end, 10) : 0;
+        if (argc > 4 || strcmp(argv[1], "-t") != 0 || numThreads <= 0 || *end != '\0') {
+            fprintf(stderr, "Error: usage is noVowels2 [-t N [file]].\n");
+            exit(1);
+        }
+        FILE *fileptr = stdin;
+        if (argc == 4) {
+            fileptr = fopen(argv[3], "r");
+            if (fileptr == NULL) {
+                fprintf(stderr, "Error opening file %s.\n", argv[3]);
+                exit(1);
+            }
+        }
+        int i;
+        retVal = groupParallel(fileno(fileptr), numThreads, &groups);
+        for (i = 0; i < retVal; i++) {
             fprintf(stderr, "Error: input contained non-alphabetical character.\n");
-            retVal++;
+        }
+        if (fileptr != stdin) {
+            fclose(fileptr);
+        }
+    }
+    else {
+        char buff[65];
+        char key[65];
+        initTable(&groups);
+        while (scanf("%64s", buff) != EOF) {
+            if (consonantKey(buff, key) >= 0) {
+                add(&groups, buff, key);
+            }
+            else {
+                fprintf(stderr, "Error: input contained non-alphabetical character.\n");
+                retVal++;
+            }
         }
     }
     // Print all, skipping over the first node which contains only blank and all-vowel strings
-    if (head->next != NULL) {
-        printAll(head->next);
+    if (groups.head->next != NULL) {
+        printAll(groups.head->next);
     }
 
     return (retVal > 0);
@@ -5,27 +5,170 @@
  *
  * Purpose: Reads commands from either a file or stdin to create pages, create links between them, and determine
  * if 2 pages are connected using DFS.
+ * Optional command-line flags (before the filename):
+ *   -i            answer @isConnected from a precomputed reachability index instead of a fresh DFS
+ *   -p threads    answer @isConnected with a parallel, direction-optimizing BFS using that many threads
+ *   -b            benchmark: time both DFS and the parallel BFS for every @isConnected (results go to stderr)
+ *   -m            bulk-load the input: mmap it, split lines on a reader thread and tokenize batches of lines on worker
+ *                 threads, while the main thread still applies every command in file order
+ *   -l graphfile  start from a page graph saved with -s, then replay graphfile.log (pages and links added by
+ *                 earlier sessions that loaded it). New pages and links from this session are appended to that log.
+ *   -s graphfile  after the input is processed, save every page and link to graphfile and clear graphfile.log
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+/*
+ * Links are stored as page ids in a growable array, in the order they were added. Every page implicitly links to
+ * itself, so that link isn't stored. Once a page has more than LINK_SET_THRESHOLD links, an open-addressing hash set
+ * of the same ids is kept alongside the array so duplicate checks don't have to scan it.
+ */
+#define LINK_SET_THRESHOLD 16
 
 typedef struct pageNode {
     char *pageName;
-    struct linkNode *linkHead;
+    int id;
+    int *links;
+    int numLinks;
+    int linkCap;
+    int *linkSet;
+    int linkSetCap;
     struct pageNode *next;
     int visited;
 } pageNode;
 
-typedef struct linkNode {
-    pageNode *linkedTo;
-    struct linkNode *next;
-} linkNode;
-
 pageNode *head;
+pageNode *tail;
 int errorSeen = 0;
 
+// Open-addressing hash table of every real page, keyed by name
+pageNode **pageHash = NULL;
+int pageHashCap = 0;
+
+// Every real page indexed by id, in creation order (the dummy head isn't included)
+pageNode **pageTable = NULL;
+int numPages = 0;
+int pageTableSize = 0;
+
+/*
+ * Reachability index: strongly connected components are condensed into a DAG, and every component gets two
+ * GRAIL-style interval labels. If a reaches b, b's intervals nest inside a's, so most negative queries never
+ * search at all; the rest run a DFS over the (much smaller) DAG that skips components whose labels rule them out.
+ */
+#define NUM_LABELS 2
+
+int useIndex = 0;
+int indexValid = 0;
+int *sccOf = NULL;          // page id -> component id (components are numbered sinks first)
+int numSccs = 0;
+int *dagStart = NULL;       // DAG edges of component c are dagEdges[dagStart[c]] to dagEdges[dagStart[c + 1] - 1]
+int *dagEdges = NULL;
+int *labelLow[NUM_LABELS];
+int *labelPost[NUM_LABELS];
+int *dagStamp = NULL;       // per-component visited marker for query searches
+int curStamp = 0;
+
+/*
+ * Parallel BFS: a level-synchronous search over a CSR snapshot of the graph. Each level either pushes from the
+ * frontier along out-links (top-down) or, once the frontier covers a large share of the remaining edges, has every
+ * unvisited page look for a parent in the frontier along its in-links (bottom-up).
+ */
+#define BFS_ALPHA 14            // switch to bottom-up once frontier edges > unexplored edges / BFS_ALPHA
+#define BFS_BETA 24             // switch back to top-down once the frontier has < numPages / BFS_BETA pages
+#define BFS_CHUNK 64            // pages handed to a thread at a time
+#define WORD_BITS (8 * (int) sizeof(unsigned long))
+
+typedef struct bfsThread {
+    pthread_t thread;
+    int index;
+    int *next;                  // pages this thread discovered on the current level
+    int numNext;
+    int nextCap;
+} bfsThread;
+
+int numThreads = 0;             // 0 means @isConnected uses the sequential DFS
+int benchmark = 0;
+int csrValid = 0;
+int *outStart = NULL;           // out-links of page p are outEdges[outStart[p]] to outEdges[outStart[p + 1] - 1]
+int *outEdges = NULL;
+int *inStart = NULL;            // same layout for in-links
+int *inEdges = NULL;
+
+// State shared by the BFS threads during a single query
+unsigned long *bfsVisited = NULL;
+unsigned long *bfsFrontierBits = NULL;
+int *bfsFrontier = NULL;
+int bfsFrontierSize;
+int bfsDest;
+int bfsBottomUp;
+int bfsCursor;
+int bfsFound;
+int bfsDone;
+long bfsUnexplored;
+pthread_barrier_t bfsBarrier;
+bfsThread *bfsThreads = NULL;
+
+/*
+ * Bulk loading: the reader thread fills batches of lines, workers tokenize whole batches, and the main thread applies
+ * them in sequence. Batch number n lives in loadSlots[n % LOAD_SLOTS], so the reader can't get more than LOAD_SLOTS
+ * batches ahead of the main thread.
+ */
+#define LINE_BATCH 1024
+#define LOAD_SLOTS 64
+
+typedef struct lineBatch {
+    int numLines;
+    char *lineStart[LINE_BATCH];
+    char *lineEnd[LINE_BATCH];      // the byte at lineEnd is writable, so the last token can be null-terminated
+    int firstToken[LINE_BATCH + 1]; // tokens of line i are tokens[firstToken[i]] to tokens[firstToken[i + 1] - 1]
+    char **tokens;
+    int tokenCap;
+    long parsedSeq;                 // sequence number of the batch whose tokens are ready, or -1
+} lineBatch;
+
+int bulkLoad = 0;
+char *loadData;
+size_t loadSize;
+char *loadTail = NULL;              // copy of a final line with no newline after it
+lineBatch *loadSlots = NULL;
+long batchesRead, batchesClaimed, batchesApplied;
+int readerDone;
+pthread_mutex_t loadLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t loadChanged = PTHREAD_COND_INITIALIZER;
+
+// Token buffer for lines read one at a time
+char **lineTokens = NULL;
+int lineTokenCap = 0;
+
+/*
+ * Saved page graphs. The file is laid out so it can be mapped and used in place: page names and link arrays of a
+ * loaded graph point straight into the mapping until a page gets a new link, and every process that loads the same
+ * file shares its pages through the page cache.
+ */
+#define GRAPH_MAGIC "LNKGRPH1"
+
+typedef struct graphHeader {
+    char magic[8];
+    int numPages;
+    int numLinks;
+    long namesSize;
+    // Followed by: long nameOffset[numPages], int linkStart[numPages + 1], int links[numLinks], char names[namesSize]
+} graphHeader;
+
+char *graphData = NULL;
+size_t graphSize = 0;
+FILE *appendLog = NULL;
+
 /**
  * Clear the visited flag of every node in the list at the start of DFS
  */
@@ -38,229 +181,1061 @@ void clearAllVisited() {
 }
 
 /**
- * Allocate memory for and return pointer to a new linkNode that points to a pageNode
- * @param node: pageNode to point to
- * @return a pointer to the new node
+ * Check whether a pointer is into the mapped graph file (and so mustn't be freed or resized)
+ * @param ptr : pointer to check
+ * @return 1 if it's in the mapping, 0 otherwise
  */
-linkNode *buildLinkNode(pageNode *node) {
-    linkNode *retVal = malloc(sizeof(linkNode));
+int inGraphFile(void *ptr) {
+    return graphData != NULL && (char *) ptr >= graphData && (char *) ptr < graphData + graphSize;
+}
+
+/**
+ * Allocate memory for and return pointer to a new pageNode that has a page name and (implicitly) links to itself
+ * @param pageName: name of the page, which the node uses as is (not copied)
+ * @return point to the new node
+ */
+pageNode *buildPageNodeNamed(char *pageName) {
+    pageNode *retVal = malloc(sizeof(pageNode));
     if (retVal == NULL) {
         fprintf(stderr, "Memory Error.\n");
         exit(1);
     }
-    retVal->linkedTo = node;
+    retVal->pageName = pageName;
+    retVal->links = NULL;
+    retVal->numLinks = 0;
+    retVal->linkCap = 0;
+    retVal->linkSet = NULL;
+    retVal->linkSetCap = 0;
     retVal->next = NULL;
+
+    // Record the page in the id table, growing it as needed
+    if (numPages == pageTableSize) {
+        pageTableSize = pageTableSize == 0 ? 64 : pageTableSize * 2;
+        pageTable = realloc(pageTable, pageTableSize * sizeof(pageNode *));
+        if (pageTable == NULL) {
+            fprintf(stderr, "Memory Error.\n");
+            exit(1);
+        }
+    }
+    retVal->id = numPages;
+    pageTable[numPages++] = retVal;
+
     return retVal;
 }
 
 /**
- * Allocate memory for and return pointer to a new pageNode that has a page name and links to itself
+ * Allocate memory for and return pointer to a new pageNode with its own copy of a page name
  * @param pageName: name of the page
  * @return point to the new node
  */
 pageNode *buildPageNode(char *pageName) {
-    pageNode *retVal = malloc(sizeof(pageNode));
+    return buildPageNodeNamed(strdup(pageName));
+}
+
+/**
+ * Frees the link array and link set for a particular pageNode
+ * @param pageptr: page to free links on
+ */
+void freeLinks(pageNode *pageptr) {
+    if (!inGraphFile(pageptr->links)) {
+        free(pageptr->links);
+    }
+    free(pageptr->linkSet);
+}
+
+/**
+ * FNV-1a hash of a page name
+ */
+unsigned int hashName(char *name) {
+    unsigned int hash = 2166136261u;
+    while (*name != '\0') {
+        hash = (hash ^ (unsigned char) *name) * 16777619u;
+        name++;
+    }
+    return hash;
+}
+
+/**
+ * Put a page into the page hash table, assuming there's room and it isn't there already
+ * @param pageptr : page to insert
+ */
+void pageHashInsert(pageNode *pageptr) {
+    int slot = (int) (hashName(pageptr->pageName) & (unsigned int) (pageHashCap - 1));
+    while (pageHash[slot] != NULL) {
+        slot = (slot + 1) & (pageHashCap - 1);
+    }
+    pageHash[slot] = pageptr;
+}
+
+/**
+ * Searches the page hash table for a page matching a string. Returns that node if found, NULL otherwise
+ * @param pageName : string to search for
+ * @return pointer to the pageName's node, or NULL if not found
+ */
+pageNode *findPageNode(char *pageName) {
+    if (pageHashCap == 0) {
+        return NULL;
+    }
+    int slot = (int) (hashName(pageName) & (unsigned int) (pageHashCap - 1));
+    while (pageHash[slot] != NULL) {
+        if (strcmp(pageHash[slot]->pageName, pageName) == 0) {
+            return pageHash[slot];
+        }
+        slot = (slot + 1) & (pageHashCap - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Put a newly built page at the end of the linked list of pageNodes and into the hash table
+ * @param pageptr: page to add
+ */
+void appendPage(pageNode *pageptr) {
+    int i;
+    tail->next = pageptr;
+    tail = pageptr;
+    indexValid = 0;
+    csrValid = 0;
+
+    // Keep the hash table no more than half full, rebuilding it from the page table when it grows
+    if (2 * numPages > pageHashCap) {
+        free(pageHash);
+        pageHashCap = pageHashCap == 0 ? 256 : pageHashCap * 2;
+        pageHash = calloc(pageHashCap, sizeof(pageNode *));
+        if (pageHash == NULL) {
+            fprintf(stderr, "Memory Error.\n");
+            exit(1);
+        }
+        for (i = 0; i < numPages; i++) {
+            pageHashInsert(pageTable[i]);
+        }
+    }
+    else {
+        pageHashInsert(tail);
+    }
+}
+
+/**
+ * Add a new page to the end of the linked list of pageNodes. Print an error if a page with that name exists
+ * @param pageName: name of page to be stored
+ */
+void addPage(char *pageName) {
+    if (findPageNode(pageName) != NULL) {
+        fprintf(stderr, "Error: page %s already exists\n", pageName);
+        errorSeen++;
+        return;
+    }
+    appendPage(buildPageNode(pageName));
+    if (appendLog != NULL) {
+        fprintf(appendLog, "@addPages %s\n", pageName);
+    }
+}
+
+/**
+ * Allocate an int array for the reachability index
+ * @param count : number of ints
+ * @return pointer to the array
+ */
+int *indexArray(int count) {
+    int *retVal = malloc((count > 0 ? count : 1) * sizeof(int));
     if (retVal == NULL) {
         fprintf(stderr, "Memory Error.\n");
         exit(1);
     }
-    retVal->pageName = strdup(pageName);
-    retVal->linkHead = buildLinkNode(retVal);
-    retVal->next = NULL;
+    return retVal;
+}
+
+/**
+ * Free everything held by the reachability index
+ */
+void freeIndex() {
+    int i;
+    free(sccOf);
+    free(dagStart);
+    free(dagEdges);
+    free(dagStamp);
+    for (i = 0; i < NUM_LABELS; i++) {
+        free(labelLow[i]);
+        free(labelPost[i]);
+        labelLow[i] = NULL;
+        labelPost[i] = NULL;
+    }
+    sccOf = dagStart = dagEdges = dagStamp = NULL;
+    numSccs = 0;
+    indexValid = 0;
+}
+
+/**
+ * Find the strongly connected components of the page graph with an iterative version of Tarjan's algorithm,
+ * filling in sccOf and numSccs. Components are numbered in the order Tarjan finishes them, so every link between
+ * two different components goes from a higher number to a lower one.
+ */
+void findSccs() {
+    int *order = indexArray(numPages);
+    int *lowLink = indexArray(numPages);
+    int *stack = indexArray(numPages);
+    int *onStack = indexArray(numPages);
+    int *callPage = indexArray(numPages);
+    int *callLink = indexArray(numPages);
+    int stackSize = 0;
+    int nextOrder = 0;
+    int i;
+
+    numSccs = 0;
+    for (i = 0; i < numPages; i++) {
+        order[i] = -1;
+        onStack[i] = 0;
+    }
+
+    for (i = 0; i < numPages; i++) {
+        if (order[i] != -1) {
+            continue;
+        }
+        // Simulate the recursion with an explicit call stack of (page, next link to look at)
+        int depth = 0;
+        callPage[0] = i;
+        callLink[0] = 0;
+        order[i] = lowLink[i] = nextOrder++;
+        stack[stackSize++] = i;
+        onStack[i] = 1;
+        while (depth >= 0) {
+            int page = callPage[depth];
+            int link = callLink[depth];
+            if (link < pageTable[page]->numLinks) {
+                int next = pageTable[page]->links[link];
+                callLink[depth]++;
+                if (order[next] == -1) {
+                    depth++;
+                    callPage[depth] = next;
+                    callLink[depth] = 0;
+                    order[next] = lowLink[next] = nextOrder++;
+                    stack[stackSize++] = next;
+                    onStack[next] = 1;
+                }
+                else if (onStack[next] && order[next] < lowLink[page]) {
+                    lowLink[page] = order[next];
+                }
+                continue;
+            }
+            // Every link has been explored: pop the component if this page is its root
+            if (lowLink[page] == order[page]) {
+                int member;
+                do {
+                    member = stack[--stackSize];
+                    onStack[member] = 0;
+                    sccOf[member] = numSccs;
+                } while (member != page);
+                numSccs++;
+            }
+            depth--;
+            if (depth >= 0 && lowLink[page] < lowLink[callPage[depth]]) {
+                lowLink[callPage[depth]] = lowLink[page];
+            }
+        }
+    }
+
+    free(order);
+    free(lowLink);
+    free(stack);
+    free(onStack);
+    free(callPage);
+    free(callLink);
+}
+
+/**
+ * Build the condensed DAG of components in dagStart/dagEdges, with duplicate edges removed
+ */
+void buildDag() {
+    int *count = indexArray(numSccs + 1);
+    int i, c, link;
+
+    // Group pages by component so each component's outgoing edges can be gathered at once
+    int *memberStart = indexArray(numSccs + 1);
+    int *members = indexArray(numPages);
+    for (c = 0; c <= numSccs; c++) {
+        memberStart[c] = 0;
+    }
+    for (i = 0; i < numPages; i++) {
+        memberStart[sccOf[i] + 1]++;
+    }
+    for (c = 0; c < numSccs; c++) {
+        memberStart[c + 1] += memberStart[c];
+        count[c] = memberStart[c];
+    }
+    for (i = 0; i < numPages; i++) {
+        members[count[sccOf[i]]++] = i;
+    }
+
+    // Two passes over the links: count distinct edges per component, then fill them in
+    int pass, total = 0;
+    for (c = 0; c < numSccs; c++) {
+        dagStamp[c] = -1;
+    }
+    dagStart = indexArray(numSccs + 1);
+    dagEdges = NULL;
+    for (pass = 0; pass < 2; pass++) {
+        total = 0;
+        for (c = 0; c < numSccs; c++) {
+            dagStart[c] = total;
+            for (i = memberStart[c]; i < memberStart[c + 1]; i++) {
+                pageNode *page = pageTable[members[i]];
+                for (link = 0; link < page->numLinks; link++) {
+                    int to = sccOf[page->links[link]];
+                    if (to != c && dagStamp[to] != c + pass * numSccs) {
+                        dagStamp[to] = c + pass * numSccs;
+                        if (pass == 1) {
+                            dagEdges[total] = to;
+                        }
+                        total++;
+                    }
+                }
+            }
+        }
+        dagStart[numSccs] = total;
+        if (pass == 0) {
+            dagEdges = indexArray(total);
+        }
+    }
+
+    free(count);
+    free(memberStart);
+    free(members);
+}
+
+/**
+ * Give every component an interval [low, post] from a post-order traversal of the DAG, where post is the
+ * component's finishing rank and low is the smallest rank among everything it reaches
+ * @param label : which labeling to fill in; odd labelings visit roots and children in reverse order
+ */
+void labelDag(int label) {
+    int *low = labelLow[label];
+    int *post = labelPost[label];
+    int *callComp = indexArray(numSccs);
+    int *callEdge = indexArray(numSccs);
+    int reverse = label % 2;
+    int rank = 0;
+    int r, c;
+
+    for (c = 0; c < numSccs; c++) {
+        post[c] = -1;
+        low[c] = INT_MAX;
+    }
+    for (r = 0; r < numSccs; r++) {
+        int root = reverse ? r : numSccs - 1 - r;
+        if (post[root] != -1 || low[root] != INT_MAX) {
+            continue;
+        }
+        int depth = 0;
+        callComp[0] = root;
+        callEdge[0] = reverse ? dagStart[root + 1] - 1 : dagStart[root];
+        low[root] = INT_MAX - 1;
+        while (depth >= 0) {
+            int comp = callComp[depth];
+            int e = callEdge[depth];
+            if (e >= dagStart[comp] && e < dagStart[comp + 1]) {
+                int child = dagEdges[e];
+                callEdge[depth] += reverse ? -1 : 1;
+                if (low[child] == INT_MAX) {
+                    // Not seen yet: descend
+                    depth++;
+                    callComp[depth] = child;
+                    callEdge[depth] = reverse ? dagStart[child + 1] - 1 : dagStart[child];
+                    low[child] = INT_MAX - 1;
+                }
+                else if (low[child] < low[comp]) {
+                    // Already finished (the graph is acyclic, so it can't be in progress)
+                    low[comp] = low[child];
+                }
+                continue;
+            }
+            post[comp] = rank++;
+            if (post[comp] < low[comp]) {
+                low[comp] = post[comp];
+            }
+            depth--;
+            if (depth >= 0 && low[comp] < low[callComp[depth]]) {
+                low[callComp[depth]] = low[comp];
+            }
+        }
+    }
+
+    free(callComp);
+    free(callEdge);
+}
+
+/**
+ * Rebuild the whole reachability index from the current pages and links
+ */
+void buildIndex() {
+    int i;
+    freeIndex();
+    sccOf = indexArray(numPages);
+    findSccs();
+    dagStamp = indexArray(numSccs);
+    buildDag();
+    for (i = 0; i < NUM_LABELS; i++) {
+        labelLow[i] = indexArray(numSccs);
+        labelPost[i] = indexArray(numSccs);
+        labelDag(i);
+    }
+    for (i = 0; i < numSccs; i++) {
+        dagStamp[i] = 0;
+    }
+    curStamp = 0;
+    indexValid = 1;
+}
+
+/**
+ * Check whether every interval label of component 'from' contains the matching label of component 'to'
+ * @return 0 if 'to' definitely can't be reached from 'from', 1 if it might be
+ */
+int labelsAllow(int from, int to) {
+    int i;
+    if (from < to) {
+        return 0;
+    }
+    for (i = 0; i < NUM_LABELS; i++) {
+        if (labelLow[i][to] < labelLow[i][from] || labelPost[i][to] > labelPost[i][from]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Answer a reachability query between two components using the index
+ * @param from : source component
+ * @param to : destination component
+ * @return 1 if 'to' can be reached from 'from', 0 otherwise
+ */
+int componentReaches(int from, int to) {
+    if (from == to) {
+        return 1;
+    }
+    if (!labelsAllow(from, to)) {
+        return 0;
+    }
+    // The labels couldn't rule it out: search the DAG, only stepping into components that might still reach 'to'
+    int *stack = indexArray(numSccs);
+    int stackSize = 0;
+    int found = 0;
+    int e;
+    if (++curStamp == INT_MAX) {
+        for (e = 0; e < numSccs; e++) {
+            dagStamp[e] = 0;
+        }
+        curStamp = 1;
+    }
+    stack[stackSize++] = from;
+    dagStamp[from] = curStamp;
+    while (stackSize > 0 && !found) {
+        int comp = stack[--stackSize];
+        for (e = dagStart[comp]; e < dagStart[comp + 1]; e++) {
+            int child = dagEdges[e];
+            if (child == to) {
+                found = 1;
+                break;
+            }
+            if (dagStamp[child] != curStamp && labelsAllow(child, to)) {
+                dagStamp[child] = curStamp;
+                stack[stackSize++] = child;
+            }
+        }
+    }
+    free(stack);
+    return found;
+}
+
+/**
+ * Determine if two pages are connected using the reachability index, rebuilding it first if it's out of date
+ * @param source : source pageNode
+ * @param dest : destination pageNode
+ * @return 1 if there's a page from 'source' to 'dest', 0 otherwise
+ */
+int indexConnected(pageNode *source, pageNode *dest) {
+    // The dummy head (id -1) isn't in the index and reaches nothing
+    if (source->id < 0 || dest->id < 0) {
+        return 0;
+    }
+    if (!indexValid) {
+        buildIndex();
+    }
+    return componentReaches(sccOf[source->id], sccOf[dest->id]);
+}
+
+/**
+ * Keep the reachability index up to date after a new link. A link inside one component, or between components
+ * that were already connected, doesn't change reachability; anything else marks the index for a rebuild.
+ * @param source : source pageNode
+ * @param dest : destination pageNode
+ */
+void indexLinkAdded(pageNode *source, pageNode *dest) {
+    if (!indexValid || source->id < 0 || dest->id < 0) {
+        return;
+    }
+    if (!componentReaches(sccOf[source->id], sccOf[dest->id])) {
+        indexValid = 0;
+    }
+}
+
+/**
+ * Hash a page id into a link set with 'cap' slots (cap is a power of 2)
+ */
+int linkSetSlot(int id, int cap) {
+    return (int) (((unsigned int) id * 2654435761u) & (unsigned int) (cap - 1));
+}
+
+/**
+ * Insert a page id into a page's link set, assuming the set has room and doesn't already contain it
+ * @param pageptr : page whose set to insert into
+ * @param id : page id to insert
+ */
+void linkSetInsert(pageNode *pageptr, int id) {
+    int slot = linkSetSlot(id, pageptr->linkSetCap);
+    while (pageptr->linkSet[slot] != -1) {
+        slot = (slot + 1) & (pageptr->linkSetCap - 1);
+    }
+    pageptr->linkSet[slot] = id;
+}
+
+/**
+ * Check whether a page already links to a page id. Small pages scan their array; large ones use their hash set
+ * @param pageptr : page to check
+ * @param id : page id to look for
+ * @return 1 if the link exists, 0 otherwise
+ */
+int hasLink(pageNode *pageptr, int id) {
+    int i;
+    if (pageptr->id == id) {
+        return 1;
+    }
+    if (pageptr->linkSet == NULL) {
+        for (i = 0; i < pageptr->numLinks; i++) {
+            if (pageptr->links[i] == id) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    int slot = linkSetSlot(id, pageptr->linkSetCap);
+    while (pageptr->linkSet[slot] != -1) {
+        if (pageptr->linkSet[slot] == id) {
+            return 1;
+        }
+        slot = (slot + 1) & (pageptr->linkSetCap - 1);
+    }
+    return 0;
+}
+
+/**
+ * Rebuild a page's link set with room for twice as many links as it has now, keeping it at most half full
+ * @param pageptr : page whose set to rebuild
+ */
+void growLinkSet(pageNode *pageptr) {
+    int i;
+    free(pageptr->linkSet);
+    pageptr->linkSetCap = 4 * LINK_SET_THRESHOLD;
+    while (pageptr->linkSetCap < 4 * (pageptr->numLinks + 1)) {
+        pageptr->linkSetCap *= 2;
+    }
+    pageptr->linkSet = malloc(pageptr->linkSetCap * sizeof(int));
+    if (pageptr->linkSet == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    for (i = 0; i < pageptr->linkSetCap; i++) {
+        pageptr->linkSet[i] = -1;
+    }
+    for (i = 0; i < pageptr->numLinks; i++) {
+        linkSetInsert(pageptr, pageptr->links[i]);
+    }
+}
+
+/**
+ * Add a link in source's link array to dest. Skips adding repeat links and links to or from the dummy head, but no
+ * error reported
+ * @param source : source pageNode
+ * @param dest : destination pageNode
+ */
+void addLink(pageNode *source, pageNode *dest) {
+    // The dummy head (id -1) has no slot in the page table, so it can't be linked to or from
+    if (source->id < 0 || dest->id < 0 || hasLink(source, dest->id)) {
+        return;
+    }
+    // Grow the array by doubling. Links still in a mapped graph file get copied out first
+    if (source->numLinks == source->linkCap) {
+        source->linkCap = source->linkCap == 0 ? 4 : source->linkCap * 2;
+        if (inGraphFile(source->links)) {
+            int *copy = malloc(source->linkCap * sizeof(int));
+            if (copy != NULL) {
+                memcpy(copy, source->links, source->numLinks * sizeof(int));
+            }
+            source->links = copy;
+        }
+        else {
+            source->links = realloc(source->links, source->linkCap * sizeof(int));
+        }
+        if (source->links == NULL) {
+            fprintf(stderr, "Memory Error.\n");
+            exit(1);
+        }
+    }
+    source->links[source->numLinks++] = dest->id;
+    csrValid = 0;
+    if (appendLog != NULL) {
+        fprintf(appendLog, "@addLinks %s %s\n", source->pageName, dest->pageName);
+    }
+
+    // Keep the hash set no more than half full once the page is big enough to need one
+    if (source->numLinks > LINK_SET_THRESHOLD) {
+        if (source->linkSet == NULL || 2 * source->numLinks > source->linkSetCap) {
+            growLinkSet(source);
+        }
+        else {
+            linkSetInsert(source, dest->id);
+        }
+    }
+    indexLinkAdded(source, dest);
+}
+
+/**
+ * Print all the links within a page, starting with the page's implicit link to itself
+ * @param pageptr
+ */
+void printLinks(pageNode *pageptr) {
+    int i;
+    printf("%s links to: %s ", pageptr->pageName, pageptr->pageName);
+    for (i = 0; i < pageptr->numLinks; i++) {
+        printf("%s ", pageTable[pageptr->links[i]]->pageName);
+    }
+    printf("\n");
+}
+
+/**
+ * Print a list of all pages and all of the links within those pages
+ */
+void printPages() {
+    // Skip over dummy head node
+    pageNode *pageptr = head->next;
+    while (pageptr != NULL) {
+        printLinks(pageptr);
+        pageptr = pageptr->next;
+    }
+}
+
+/**
+ * Perform a recursive DFS to see if two nodes are connected
+ * @param source : source pageNode
+ * @param dest : destination pageNode
+ * @return 1 if there's a page from 'source' to 'dest', 0 otherwise
+ */
+int DFS(pageNode *source, pageNode *dest) {
+    if (source == dest) {
+        return 1;
+    }
+    else {
+        if (source->visited == 1) {
+            return 0;
+        }
+        source->visited = 1;
+        int i;
+        for (i = 0; i < source->numLinks; i++) {
+            if (DFS(pageTable[source->links[i]], dest) == 1) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
+
+/**
+ * Free the CSR snapshot and the BFS work arrays
+ */
+void freeCsr() {
+    free(outStart);
+    free(outEdges);
+    free(inStart);
+    free(inEdges);
+    free(bfsVisited);
+    free(bfsFrontierBits);
+    free(bfsFrontier);
+    outStart = outEdges = inStart = inEdges = bfsFrontier = NULL;
+    bfsVisited = bfsFrontierBits = NULL;
+    csrValid = 0;
+}
+
+/**
+ * Build CSR arrays of every page's out-links and in-links, plus the work arrays the BFS needs
+ */
+void buildCsr() {
+    int words = (numPages + WORD_BITS - 1) / WORD_BITS;
+    int p, i;
+
+    freeCsr();
+    outStart = indexArray(numPages + 1);
+    inStart = indexArray(numPages + 1);
+    for (p = 0; p <= numPages; p++) {
+        inStart[p] = 0;
+    }
+    outStart[0] = 0;
+    for (p = 0; p < numPages; p++) {
+        outStart[p + 1] = outStart[p] + pageTable[p]->numLinks;
+        for (i = 0; i < pageTable[p]->numLinks; i++) {
+            inStart[pageTable[p]->links[i] + 1]++;
+        }
+    }
+    for (p = 0; p < numPages; p++) {
+        inStart[p + 1] += inStart[p];
+    }
+
+    // Fill both edge arrays, using a copy of inStart as the insertion cursors
+    int *inFill = indexArray(numPages);
+    outEdges = indexArray(outStart[numPages]);
+    inEdges = indexArray(inStart[numPages]);
+    memcpy(inFill, inStart, numPages * sizeof(int));
+    for (p = 0; p < numPages; p++) {
+        memcpy(outEdges + outStart[p], pageTable[p]->links, pageTable[p]->numLinks * sizeof(int));
+        for (i = 0; i < pageTable[p]->numLinks; i++) {
+            inEdges[inFill[pageTable[p]->links[i]]++] = p;
+        }
+    }
+    free(inFill);
+
+    bfsVisited = malloc((words > 0 ? words : 1) * sizeof(unsigned long));
+    bfsFrontierBits = malloc((words > 0 ? words : 1) * sizeof(unsigned long));
+    bfsFrontier = indexArray(numPages);
+    if (bfsVisited == NULL || bfsFrontierBits == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    csrValid = 1;
+}
 
-    return retVal;
+/**
+ * Atomically mark a page as visited
+ * @param page : page id
+ * @return 1 if this call marked it, 0 if it was already visited
+ */
+int claimPage(int page) {
+    unsigned long mask = 1UL << (page % WORD_BITS);
+    if (__atomic_load_n(&bfsVisited[page / WORD_BITS], __ATOMIC_RELAXED) & mask) {
+        return 0;
+    }
+    return (__sync_fetch_and_or(&bfsVisited[page / WORD_BITS], mask) & mask) == 0;
 }
 
 /**
- * Frees the entire linked list of linkNodes for a particular pageNode
- * @param pageptr: page to free linkNodes on
+ * Record a page discovered by a thread on this level
+ * @param self : discovering thread
+ * @param page : page id
  */
-void freeLinkNodes(pageNode *pageptr) {
-    linkNode *linkptr = pageptr->linkHead;
-    linkNode *next = linkptr->next;
-    free(linkptr);
-    linkptr = next;
-    while (linkptr != NULL) {
-        next = linkptr->next;
-        free(linkptr);
-        linkptr = next;
+void pushNext(bfsThread *self, int page) {
+    if (self->numNext == self->nextCap) {
+        self->nextCap = self->nextCap == 0 ? 1024 : self->nextCap * 2;
+        self->next = realloc(self->next, self->nextCap * sizeof(int));
+        if (self->next == NULL) {
+            fprintf(stderr, "Memory Error.\n");
+            exit(1);
+        }
+    }
+    self->next[self->numNext++] = page;
+    // Several threads can find the destination in the same level, so the flag is set atomically
+    if (page == bfsDest) {
+        __atomic_store_n(&bfsFound, 1, __ATOMIC_RELAXED);
     }
 }
 
 /**
- * Add a new page to the linked list of pageNodes. Print an error if a page with that name exists
- * Also links the page to itself when initializing the linkNode list
- * @param pageName: name of page to be stored
+ * Top-down step: take chunks of the frontier and claim every unvisited page they link to
+ * @param self : calling thread
  */
-void addPage(char *pageName) {
-    pageNode *pageptr = head;
-    // Navigate to the end of the list, checking if the page already exists
-    while (pageptr->next != NULL) {
-        if (strcmp(pageName, pageptr->pageName) == 0) {
-            fprintf(stderr, "Error: page %s already exists\n", pageName);
-            errorSeen++;
-            return;
+void topDownStep(bfsThread *self) {
+    int start, i, e;
+    while ((start = __sync_fetch_and_add(&bfsCursor, BFS_CHUNK)) < bfsFrontierSize) {
+        int end = start + BFS_CHUNK < bfsFrontierSize ? start + BFS_CHUNK : bfsFrontierSize;
+        for (i = start; i < end; i++) {
+            int page = bfsFrontier[i];
+            for (e = outStart[page]; e < outStart[page + 1]; e++) {
+                if (claimPage(outEdges[e])) {
+                    pushNext(self, outEdges[e]);
+                }
+            }
         }
-        else {
-            pageptr = pageptr->next;
+    }
+}
+
+/**
+ * Bottom-up step: take chunks of pages and have each unvisited one look for an in-link from the frontier.
+ * Chunks line up with bitmap words, so a page is only ever claimed by the thread that owns its chunk.
+ * @param self : calling thread
+ */
+void bottomUpStep(bfsThread *self) {
+    int start, page, e;
+    while ((start = __sync_fetch_and_add(&bfsCursor, BFS_CHUNK)) < numPages) {
+        int end = start + BFS_CHUNK < numPages ? start + BFS_CHUNK : numPages;
+        for (page = start; page < end; page++) {
+            if (bfsVisited[page / WORD_BITS] & (1UL << (page % WORD_BITS))) {
+                continue;
+            }
+            for (e = inStart[page]; e < inStart[page + 1]; e++) {
+                int parent = inEdges[e];
+                if (bfsFrontierBits[parent / WORD_BITS] & (1UL << (parent % WORD_BITS))) {
+                    claimPage(page);
+                    pushNext(self, page);
+                    break;
+                }
+            }
         }
     }
-    // At the end of the list. Do one last check for equality, then create a new page node
-    if (strcmp(pageName, pageptr->pageName) == 0) {
-        fprintf(stderr, "Error: page %s already exists\n", pageName);
-        errorSeen++;
+}
+
+/**
+ * Run by one thread between levels: gather every thread's discoveries into the next frontier, decide whether
+ * the search is over, and pick the direction of the next level
+ */
+void finishLevel() {
+    int t, i;
+    long frontierEdges = 0;
+
+    bfsFrontierSize = 0;
+    for (t = 0; t < numThreads; t++) {
+        memcpy(bfsFrontier + bfsFrontierSize, bfsThreads[t].next, bfsThreads[t].numNext * sizeof(int));
+        bfsFrontierSize += bfsThreads[t].numNext;
+        bfsThreads[t].numNext = 0;
+    }
+    if (__atomic_load_n(&bfsFound, __ATOMIC_RELAXED) || bfsFrontierSize == 0) {
+        bfsDone = 1;
         return;
     }
-    else {
-        pageptr->next = buildPageNode(pageName);
+
+    for (i = 0; i < bfsFrontierSize; i++) {
+        frontierEdges += outStart[bfsFrontier[i] + 1] - outStart[bfsFrontier[i]];
+    }
+    bfsUnexplored -= frontierEdges;
+    if (!bfsBottomUp && frontierEdges > bfsUnexplored / BFS_ALPHA) {
+        bfsBottomUp = 1;
     }
+    else if (bfsBottomUp && bfsFrontierSize < numPages / BFS_BETA) {
+        bfsBottomUp = 0;
+    }
+    if (bfsBottomUp) {
+        memset(bfsFrontierBits, 0, ((numPages + WORD_BITS - 1) / WORD_BITS) * sizeof(unsigned long));
+        for (i = 0; i < bfsFrontierSize; i++) {
+            bfsFrontierBits[bfsFrontier[i] / WORD_BITS] |= 1UL << (bfsFrontier[i] % WORD_BITS);
+        }
+    }
+    bfsCursor = 0;
 }
 
 /**
- * Searches the list of pageNodes for one matching a string. Returns that node if not, NULL otherwise
- * @param pageName : string to search for
- * @return pointer to the pageName's node, or NULL if not found
+ * Body of every BFS thread: run levels until the destination is found or the frontier is empty
+ * @param arg : this thread's bfsThread
  */
-pageNode *findPageNode(char *pageName) {
-    pageNode *pageptr = head;
-    while (pageptr != NULL) {
-        if (strcmp(pageptr->pageName, pageName) == 0) {
-            return pageptr;
+void *bfsWorker(void *arg) {
+    bfsThread *self = arg;
+    while (1) {
+        if (bfsBottomUp) {
+            bottomUpStep(self);
         }
         else {
-            pageptr = pageptr->next;
+            topDownStep(self);
+        }
+        pthread_barrier_wait(&bfsBarrier);
+        if (self->index == 0) {
+            finishLevel();
+        }
+        pthread_barrier_wait(&bfsBarrier);
+        if (bfsDone) {
+            return NULL;
         }
     }
-    return pageptr;
 }
 
 /**
- * Add a link in source's linked list of linkNodes to dest. Skips adding repeat nodes, but no error reported
+ * Determine if two pages are connected with a parallel BFS using numThreads threads
  * @param source : source pageNode
  * @param dest : destination pageNode
+ * @return 1 if there's a page from 'source' to 'dest', 0 otherwise
  */
-void addLink(pageNode *source, pageNode *dest) {
-    linkNode *curLink = source->linkHead;
-    while (curLink->next != NULL) {
-        if (curLink->linkedTo == dest) {
-            return;
-        }
-        else {
-            curLink = curLink->next;
+int parallelConnected(pageNode *source, pageNode *dest) {
+    int t;
+    if (source == dest) {
+        return 1;
+    }
+    if (!csrValid) {
+        buildCsr();
+    }
+
+    memset(bfsVisited, 0, ((numPages + WORD_BITS - 1) / WORD_BITS) * sizeof(unsigned long));
+    bfsVisited[source->id / WORD_BITS] |= 1UL << (source->id % WORD_BITS);
+    bfsFrontier[0] = source->id;
+    bfsFrontierSize = 1;
+    bfsDest = dest->id;
+    bfsBottomUp = 0;
+    bfsCursor = 0;
+    bfsFound = 0;
+    bfsDone = 0;
+    bfsUnexplored = outStart[numPages];
+
+    if (bfsThreads == NULL) {
+        bfsThreads = calloc(numThreads, sizeof(bfsThread));
+        if (bfsThreads == NULL) {
+            fprintf(stderr, "Memory Error.\n");
+            exit(1);
         }
     }
-    // At the end of the list. Check for equality on last node
-    if (curLink->linkedTo == dest) {
-        return;
+    pthread_barrier_init(&bfsBarrier, NULL, numThreads);
+    // The calling thread does its share of the work as thread 0
+    for (t = 0; t < numThreads; t++) {
+        bfsThreads[t].index = t;
+        bfsThreads[t].numNext = 0;
     }
-    else {
-        curLink->next = buildLinkNode(dest);
+    for (t = 1; t < numThreads; t++) {
+        if (pthread_create(&bfsThreads[t].thread, NULL, bfsWorker, &bfsThreads[t]) != 0) {
+            fprintf(stderr, "Error: couldn't create BFS thread.\n");
+            exit(1);
+        }
+    }
+    bfsWorker(&bfsThreads[0]);
+    for (t = 1; t < numThreads; t++) {
+        pthread_join(bfsThreads[t].thread, NULL);
     }
+    pthread_barrier_destroy(&bfsBarrier);
+    return __atomic_load_n(&bfsFound, __ATOMIC_RELAXED);
 }
 
 /**
- * Print all the links within a page
- * @param pageptr
+ * Free the per-thread BFS buffers
  */
-void printLinks(pageNode *pageptr) {
-    linkNode *linkptr = pageptr->linkHead;
-    printf("%s links to: ", pageptr->pageName);
-    while (linkptr != NULL) {
-        printf("%s ", linkptr->linkedTo->pageName);
-        linkptr = linkptr->next;
+void freeBfsThreads() {
+    int t;
+    if (bfsThreads == NULL) {
+        return;
     }
-    printf("\n");
+    for (t = 0; t < numThreads; t++) {
+        free(bfsThreads[t].next);
+    }
+    free(bfsThreads);
+    bfsThreads = NULL;
 }
 
 /**
- * Print a list of all pages and all of the links within those pages
+ * Current time in milliseconds, for benchmarking
  */
-void printPages() {
-    // Skip over dummy head node
-    pageNode *pageptr = head->next;
-    while (pageptr != NULL) {
-        printLinks(pageptr);
-        pageptr = pageptr->next;
-    }
+double nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
 }
 
 /**
- * Perform a recursive DFS to see if two nodes are connected
+ * Answer a query with both the sequential DFS and the parallel BFS, reporting how long each took on stderr
  * @param source : source pageNode
  * @param dest : destination pageNode
- * @return 1 if there's a page from 'source' to 'dest', 0 otherwise
+ * @return the DFS result
  */
-int DFS(pageNode *source, pageNode *dest) {
-    if (source == dest) {
-        return 1;
+int benchmarkConnected(pageNode *source, pageNode *dest) {
+    double start = nowMs();
+    clearAllVisited();
+    int dfsResult = DFS(source, dest);
+    double dfsTime = nowMs() - start;
+
+    // Time the snapshot build separately so it doesn't count against every query
+    start = nowMs();
+    if (!csrValid) {
+        buildCsr();
     }
-    else {
-        if (source->visited == 1) {
-            return 0;
+    double csrTime = nowMs() - start;
+    start = nowMs();
+    int bfsResult = parallelConnected(source, dest);
+    double bfsTime = nowMs() - start;
+
+    fprintf(stderr, "bench %s %s: DFS %.3f ms, parallel BFS (%d threads) %.3f ms (+%.3f ms snapshot)\n",
+            source->pageName, dest->pageName, dfsTime, numThreads, bfsTime, csrTime);
+    if (dfsResult != bfsResult) {
+        fprintf(stderr, "Error: DFS and parallel BFS disagree.\n");
+        errorSeen++;
+    }
+    return dfsResult;
+}
+
+/**
+ * Split a line into whitespace-separated tokens in place, null-terminating each one. Tokens have no length limit.
+ * @param line : start of the line
+ * @param end : end of the line; the byte at 'end' must be writable
+ * @param tokens : growable array to fill with pointers to the tokens, starting at index 'first'
+ * @param cap : capacity of *tokens
+ * @param first : index in *tokens to put the first token at
+ * @return number of tokens found
+ */
+int tokenize(char *line, char *end, char ***tokens, int *cap, int first) {
+    int count = 0;
+    char *ptr = line;
+    while (1) {
+        while (ptr < end && isspace((unsigned char) *ptr)) {
+            ptr++;
         }
-        source->visited = 1;
-        linkNode *curLink = source->linkHead;
-        while (curLink != NULL) {
-            if (DFS(curLink->linkedTo, dest) == 1) {
-                return 1;
+        if (ptr >= end || *ptr == '\0') {
+            return count;
+        }
+        if (first + count == *cap) {
+            *cap = *cap == 0 ? 64 : *cap * 2;
+            *tokens = realloc(*tokens, *cap * sizeof(char *));
+            if (*tokens == NULL) {
+                fprintf(stderr, "Memory Error.\n");
+                exit(1);
             }
-            curLink = curLink->next;
         }
-        return 0;
+        (*tokens)[first + count++] = ptr;
+        while (ptr < end && *ptr != '\0' && !isspace((unsigned char) *ptr)) {
+            ptr++;
+        }
+        if (ptr >= end || *ptr == '\0') {
+            *ptr = '\0';
+            return count;
+        }
+        *ptr++ = '\0';
     }
 }
 
 /**
- * Parse a line of commands. Must start with @addPages, @addLinks, or @isConnected to avoid an error
+ * Perform one command. Must start with @addPages, @addLinks, or @isConnected to avoid an error
  * Each of those 3 commands is checked for the proper number of arguments and then that function is performed
- * @param line : line to parse
+ * @param tokens : the command's tokens
+ * @param numTokens : number of tokens
  */
-void processLine(char *line) {
-    char *lineptr = line;
-    char buff[65] = "";
-    int charsRead = 0;
-    // Check for a valid operation as first argument on the line
-    int result = sscanf(lineptr, "%64s%n", buff, &charsRead);
-    lineptr += charsRead;
-    /*
-     * SPECIAL CASE: BLANK LINE
-     */
-    if(result == 0){
-        return;
-    }
+void processTokens(char **tokens, int numTokens) {
+    char *command = numTokens > 0 ? tokens[0] : "";
+    int i;
     /*
      * ADD PAGES
      */
-    if (strcmp(buff, "@addPages") == 0) {
-        // Keep reading page names until sscanf doesn't update buff
-        while (sscanf(lineptr, "%64s%n", buff, &charsRead) == 1) {
-            lineptr += charsRead;
-            addPage(buff);
+    if (strcmp(command, "@addPages") == 0) {
+        for (i = 1; i < numTokens; i++) {
+            addPage(tokens[i]);
         }
     }
         /*
          * ADD LINKS
          */
-    else if (strcmp(buff, "@addLinks") == 0) {
-        // Read the source page as the next string
-        if (sscanf(lineptr, "%64s%n", buff, &charsRead) != 1) {
+    else if (strcmp(command, "@addLinks") == 0) {
+        // The source page is the next string
+        if (numTokens < 2) {
             fprintf(stderr, "Error: no source page could be read to add links to.\n");
             errorSeen++;
         }
         else {
             // Find the source page
-            lineptr += charsRead;
-            pageNode *sourcePage = findPageNode(buff);
+            pageNode *sourcePage = findPageNode(tokens[1]);
             if (sourcePage == NULL) {
-                fprintf(stderr, "Error: source page %s does not exist.\n", buff);
+                fprintf(stderr, "Error: source page %s does not exist.\n", tokens[1]);
                 errorSeen++;
             }
             else {
-                while (sscanf(lineptr, "%64s%n", buff, &charsRead) == 1) {
-                    lineptr += charsRead;
-                    pageNode *dest = findPageNode(buff);
+                for (i = 2; i < numTokens; i++) {
+                    pageNode *dest = findPageNode(tokens[i]);
                     if (dest == NULL) {
-                        fprintf(stderr, "Error: tried to link to %s, which doesn't exist.\n", buff);
+                        fprintf(stderr, "Error: tried to link to %s, which doesn't exist.\n", tokens[i]);
                         errorSeen++;
                     }
                     else {
@@ -273,23 +1248,33 @@ void processLine(char *line) {
         /*
          * IS CONNECTED
          */
-    else if (strcmp(buff, "@isConnected") == 0) {
-        // Add a dummy string to catch more than 2 args to isConnected
-        char start[65], end[65], dummy[65];
-        if (sscanf(lineptr, "%64s %64s %64s", start, end, dummy) != 2) {
+    else if (strcmp(command, "@isConnected") == 0) {
+        if (numTokens != 3) {
             fprintf(stderr, "Error: there weren't exactly 2 page names to check for connectedness.\n");
             errorSeen++;
         }
         else {
-            pageNode *source = findPageNode(start);
-            pageNode *dest = findPageNode(end);
+            pageNode *source = findPageNode(tokens[1]);
+            pageNode *dest = findPageNode(tokens[2]);
             if (source == NULL || dest == NULL) {
                 fprintf(stderr, "Error: one of the two nodes doesn't exist.\n");
                 errorSeen++;
             }
             else {
-                clearAllVisited();
-                int connected = DFS(source, dest);
+                int connected;
+                if (useIndex) {
+                    connected = indexConnected(source, dest);
+                }
+                else if (benchmark) {
+                    connected = benchmarkConnected(source, dest);
+                }
+                else if (numThreads > 0) {
+                    connected = parallelConnected(source, dest);
+                }
+                else {
+                    clearAllVisited();
+                    connected = DFS(source, dest);
+                }
                 printf("%d\n", connected);
             }
         }
@@ -300,19 +1285,433 @@ void processLine(char *line) {
     }
 }
 
+/**
+ * Parse and perform a line of commands
+ * @param line : line to parse
+ * @param end : end of the line; the byte at 'end' must be writable
+ */
+void processLine(char *line, char *end) {
+    int numTokens = tokenize(line, end, &lineTokens, &lineTokenCap, 0);
+    processTokens(lineTokens, numTokens);
+}
+
+/**
+ * Reader thread for bulk loading: split the mapped input into batches of lines
+ * @param arg : unused
+ */
+void *loadReader(void *arg) {
+    char *ptr = loadData;
+    char *dataEnd = loadData + loadSize;
+    long seq = 0;
+    (void) arg;
+
+    while (ptr < dataEnd) {
+        // Wait for the slot to be applied before reusing it
+        pthread_mutex_lock(&loadLock);
+        while (seq - batchesApplied >= LOAD_SLOTS) {
+            pthread_cond_wait(&loadChanged, &loadLock);
+        }
+        pthread_mutex_unlock(&loadLock);
+
+        lineBatch *batch = &loadSlots[seq % LOAD_SLOTS];
+        batch->numLines = 0;
+        while (ptr < dataEnd && batch->numLines < LINE_BATCH) {
+            char *newline = memchr(ptr, '\n', dataEnd - ptr);
+            if (newline == NULL) {
+                // The last line has no newline after it, so give it a copy with room for a terminator
+                loadTail = malloc(dataEnd - ptr + 1);
+                if (loadTail == NULL) {
+                    fprintf(stderr, "Memory Error.\n");
+                    exit(1);
+                }
+                memcpy(loadTail, ptr, dataEnd - ptr);
+                loadTail[dataEnd - ptr] = '\0';
+                batch->lineStart[batch->numLines] = loadTail;
+                batch->lineEnd[batch->numLines++] = loadTail + (dataEnd - ptr);
+                ptr = dataEnd;
+            }
+            else {
+                batch->lineStart[batch->numLines] = ptr;
+                batch->lineEnd[batch->numLines++] = newline;
+                ptr = newline + 1;
+            }
+        }
+
+        pthread_mutex_lock(&loadLock);
+        batchesRead = ++seq;
+        pthread_cond_broadcast(&loadChanged);
+        pthread_mutex_unlock(&loadLock);
+    }
+
+    pthread_mutex_lock(&loadLock);
+    readerDone = 1;
+    pthread_cond_broadcast(&loadChanged);
+    pthread_mutex_unlock(&loadLock);
+    return NULL;
+}
+
+/**
+ * Worker thread for bulk loading: tokenize whole batches of lines as soon as the reader has filled them
+ * @param arg : unused
+ */
+void *loadWorker(void *arg) {
+    int i;
+    (void) arg;
+    while (1) {
+        pthread_mutex_lock(&loadLock);
+        while (batchesClaimed == batchesRead && !readerDone) {
+            pthread_cond_wait(&loadChanged, &loadLock);
+        }
+        if (batchesClaimed == batchesRead) {
+            pthread_mutex_unlock(&loadLock);
+            return NULL;
+        }
+        long seq = batchesClaimed++;
+        pthread_mutex_unlock(&loadLock);
+
+        lineBatch *batch = &loadSlots[seq % LOAD_SLOTS];
+        int numTokens = 0;
+        for (i = 0; i < batch->numLines; i++) {
+            batch->firstToken[i] = numTokens;
+            numTokens += tokenize(batch->lineStart[i], batch->lineEnd[i], &batch->tokens, &batch->tokenCap,
+                                  numTokens);
+        }
+        batch->firstToken[batch->numLines] = numTokens;
+
+        pthread_mutex_lock(&loadLock);
+        batch->parsedSeq = seq;
+        pthread_cond_broadcast(&loadChanged);
+        pthread_mutex_unlock(&loadLock);
+    }
+}
+
+/**
+ * Process every line of a file through the bulk-loading pipeline. Input that can't be mapped (pipes, terminals,
+ * empty files) is read line by line instead.
+ * @param fileptr : input file
+ */
+void processBulk(FILE *fileptr) {
+    struct stat info;
+    int numWorkers, i;
+    long seq;
+
+    if (fstat(fileno(fileptr), &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0 ||
+        (loadData = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fileptr), 0)) ==
+        MAP_FAILED) {
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t length;
+        while ((length = getline(&line, &size, fileptr)) != EOF) {
+            processLine(line, line + length);
+        }
+        free(line);
+        return;
+    }
+    loadSize = info.st_size;
+    madvise(loadData, loadSize, MADV_SEQUENTIAL);
+
+    loadSlots = calloc(LOAD_SLOTS, sizeof(lineBatch));
+    if (loadSlots == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    for (i = 0; i < LOAD_SLOTS; i++) {
+        loadSlots[i].parsedSeq = -1;
+    }
+    batchesRead = batchesClaimed = batchesApplied = 0;
+    readerDone = 0;
+
+    // One reader, and a worker for every other core (at least one)
+    numWorkers = (int) sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    pthread_t reader;
+    pthread_t *workers = malloc(numWorkers * sizeof(pthread_t));
+    if (workers == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    if (pthread_create(&reader, NULL, loadReader, NULL) != 0) {
+        fprintf(stderr, "Error: couldn't create loader thread.\n");
+        exit(1);
+    }
+    for (i = 0; i < numWorkers; i++) {
+        if (pthread_create(&workers[i], NULL, loadWorker, NULL) != 0) {
+            fprintf(stderr, "Error: couldn't create loader thread.\n");
+            exit(1);
+        }
+    }
+
+    // Apply batches strictly in file order
+    for (seq = 0;; seq++) {
+        lineBatch *batch = &loadSlots[seq % LOAD_SLOTS];
+        pthread_mutex_lock(&loadLock);
+        while (batch->parsedSeq != seq && !(readerDone && seq == batchesRead)) {
+            pthread_cond_wait(&loadChanged, &loadLock);
+        }
+        pthread_mutex_unlock(&loadLock);
+        if (batch->parsedSeq != seq) {
+            break;
+        }
+
+        for (i = 0; i < batch->numLines; i++) {
+            processTokens(batch->tokens + batch->firstToken[i], batch->firstToken[i + 1] - batch->firstToken[i]);
+        }
+
+        pthread_mutex_lock(&loadLock);
+        batchesApplied = seq + 1;
+        pthread_cond_broadcast(&loadChanged);
+        pthread_mutex_unlock(&loadLock);
+    }
+
+    pthread_join(reader, NULL);
+    for (i = 0; i < numWorkers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    for (i = 0; i < LOAD_SLOTS; i++) {
+        free(loadSlots[i].tokens);
+    }
+    free(loadSlots);
+    free(loadTail);
+    munmap(loadData, loadSize);
+}
+
+/**
+ * Name of the append log that goes with a graph file
+ * @param graphFile : graph file name
+ * @return newly allocated log file name
+ */
+char *logName(char *graphFile) {
+    char *retVal = malloc(strlen(graphFile) + 5);
+    if (retVal == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    strcpy(retVal, graphFile);
+    strcat(retVal, ".log");
+    return retVal;
+}
+
+/**
+ * Map a graph file saved with saveGraph() and build the pages from it, then replay its append log and keep the
+ * log open so this session's pages and links are added to it. Must be called before any pages exist.
+ * @param graphFile : graph file name
+ */
+void loadGraph(char *graphFile) {
+    int fd = open(graphFile, O_RDONLY);
+    struct stat info;
+    int i;
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Error opening graph file %s. Exiting.\n", graphFile);
+        exit(1);
+    }
+    graphSize = info.st_size;
+    if (graphSize < sizeof(graphHeader) ||
+        (graphData = mmap(NULL, graphSize, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "Error: %s is not a valid graph file. Exiting.\n", graphFile);
+        exit(1);
+    }
+    close(fd);
+
+    // Check the header and that the file is exactly as big as the header says
+    graphHeader *header = (graphHeader *) graphData;
+    size_t expected = sizeof(graphHeader);
+    if (memcmp(header->magic, GRAPH_MAGIC, 8) == 0 && header->numPages >= 0 && header->numLinks >= 0 &&
+        header->namesSize >= 0) {
+        expected += header->numPages * sizeof(long) + (header->numPages + 1 + (size_t) header->numLinks) * sizeof(int)
+                    + header->namesSize;
+    }
+    if (memcmp(header->magic, GRAPH_MAGIC, 8) != 0 || expected != graphSize) {
+        fprintf(stderr, "Error: %s is not a valid graph file. Exiting.\n", graphFile);
+        exit(1);
+    }
+    long *nameOffset = (long *) (header + 1);
+    int *linkStart = (int *) (nameOffset + header->numPages);
+    int *links = linkStart + header->numPages + 1;
+    char *names = (char *) (links + header->numLinks);
+
+    // Check the link ranges, link ids and names before trusting any of them
+    if (linkStart[0] != 0 || linkStart[header->numPages] != header->numLinks ||
+        (header->numPages > 0 && (header->namesSize == 0 || names[header->namesSize - 1] != '\0'))) {
+        fprintf(stderr, "Error: %s is not a valid graph file. Exiting.\n", graphFile);
+        exit(1);
+    }
+    for (i = 0; i < header->numLinks; i++) {
+        if (links[i] < 0 || links[i] >= header->numPages) {
+            fprintf(stderr, "Error: %s is not a valid graph file. Exiting.\n", graphFile);
+            exit(1);
+        }
+    }
+
+    for (i = 0; i < header->numPages; i++) {
+        if (linkStart[i + 1] < linkStart[i] || nameOffset[i] < 0 || nameOffset[i] >= header->namesSize) {
+            fprintf(stderr, "Error: %s is not a valid graph file. Exiting.\n", graphFile);
+            exit(1);
+        }
+        pageNode *pageptr = buildPageNodeNamed(names + nameOffset[i]);
+        pageptr->links = links + linkStart[i];
+        pageptr->numLinks = pageptr->linkCap = linkStart[i + 1] - linkStart[i];
+        appendPage(pageptr);
+    }
+
+    // Replay what earlier sessions added since the file was saved, then start logging this session
+    char *logFile = logName(graphFile);
+    FILE *logptr = fopen(logFile, "r");
+    if (logptr != NULL) {
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t length;
+        while ((length = getline(&line, &size, logptr)) != EOF) {
+            processLine(line, line + length);
+        }
+        free(line);
+        fclose(logptr);
+    }
+    appendLog = fopen(logFile, "a");
+    if (appendLog == NULL) {
+        fprintf(stderr, "Error: couldn't open %s to log new pages and links.\n", logFile);
+        errorSeen++;
+    }
+    free(logFile);
+}
+
+/**
+ * Write every page and link to a graph file that loadGraph() can map, and clear the file's append log. The file is
+ * written under a temporary name and renamed into place, so a graph loaded from the same file stays intact.
+ * @param graphFile : graph file name
+ */
+void saveGraph(char *graphFile) {
+    graphHeader header;
+    int i;
+    long offset = 0;
+    int linkTotal = 0;
+
+    char *tempFile = malloc(strlen(graphFile) + 5);
+    if (tempFile == NULL) {
+        fprintf(stderr, "Memory Error.\n");
+        exit(1);
+    }
+    strcpy(tempFile, graphFile);
+    strcat(tempFile, ".tmp");
+    FILE *out = fopen(tempFile, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Error: couldn't write graph file %s.\n", graphFile);
+        errorSeen++;
+        free(tempFile);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_MAGIC, 8);
+    header.numPages = numPages;
+    for (i = 0; i < numPages; i++) {
+        header.numLinks += pageTable[i]->numLinks;
+        header.namesSize += strlen(pageTable[i]->pageName) + 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    for (i = 0; i < numPages; i++) {
+        fwrite(&offset, sizeof(long), 1, out);
+        offset += strlen(pageTable[i]->pageName) + 1;
+    }
+    for (i = 0; i <= numPages; i++) {
+        fwrite(&linkTotal, sizeof(int), 1, out);
+        if (i < numPages) {
+            linkTotal += pageTable[i]->numLinks;
+        }
+    }
+    for (i = 0; i < numPages; i++) {
+        fwrite(pageTable[i]->links, sizeof(int), pageTable[i]->numLinks, out);
+    }
+    for (i = 0; i < numPages; i++) {
+        fwrite(pageTable[i]->pageName, 1, strlen(pageTable[i]->pageName) + 1, out);
+    }
+
+    if (fclose(out) != 0 || rename(tempFile, graphFile) != 0) {
+        fprintf(stderr, "Error: couldn't write graph file %s.\n", graphFile);
+        errorSeen++;
+        remove(tempFile);
+    }
+    else {
+        // Everything in the log is in the file now
+        char *logFile = logName(graphFile);
+        remove(logFile);
+        free(logFile);
+    }
+    free(tempFile);
+}
+
 int main(int argc, char **argv) {
     // Build the head of the list
     head = malloc(sizeof(pageNode));
     head->next = NULL;
     head->pageName = strdup("head");
-    head->linkHead = buildLinkNode(head);
+    head->id = -1;
+    head->links = NULL;
+    head->linkSet = NULL;
+    head->numLinks = head->linkCap = head->linkSetCap = 0;
+    tail = head;
+
+    // Flags come before the optional filename
+    int argi = 1;
+    char *loadFile = NULL;
+    char *saveFile = NULL;
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
+        if (strcmp(argv[argi], "-i") == 0) {
+            useIndex = 1;
+        }
+        else if (strcmp(argv[argi], "-p") == 0) {
+            if (argi + 1 >= argc || (numThreads = atoi(argv[argi + 1])) <= 0) {
+                fprintf(stderr, "Error: -p must be followed by a positive number of threads.\n");
+                exit(1);
+            }
+            argi++;
+        }
+        else if (strcmp(argv[argi], "-b") == 0) {
+            benchmark = 1;
+        }
+        else if (strcmp(argv[argi], "-m") == 0) {
+            bulkLoad = 1;
+        }
+        else if (strcmp(argv[argi], "-l") == 0 || strcmp(argv[argi], "-s") == 0) {
+            if (argi + 1 >= argc) {
+                fprintf(stderr, "Error: %s must be followed by a graph file name.\n", argv[argi]);
+                exit(1);
+            }
+            if (argv[argi][1] == 'l') {
+                loadFile = argv[argi + 1];
+            }
+            else {
+                saveFile = argv[argi + 1];
+            }
+            argi++;
+        }
+        else {
+            fprintf(stderr, "Error: unknown option %s.\n", argv[argi]);
+            errorSeen++;
+        }
+        argi++;
+    }
+    // Benchmarking without -p compares against one thread per core
+    if (benchmark && numThreads == 0) {
+        numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (numThreads <= 0) {
+            numThreads = 1;
+        }
+    }
+
+    if (loadFile != NULL) {
+        loadGraph(loadFile);
+    }
 
     // Determine input stream: defaults to stdin then checks for filename command-line argument
     // flag for closing the file at the end
     int fromFile = 0;
     FILE *fileptr = stdin;
-    if (argc > 1) {
-        char *filename = argv[1];
+    if (argc > argi) {
+        char *filename = argv[argi];
         fromFile = 1;
         fileptr = fopen(filename, "r");
         if (fileptr == NULL) {
@@ -320,32 +1719,56 @@ int main(int argc, char **argv) {
             exit(1);
         }
         // Extra command-line args should produce an error
-        if(argc > 2){
+        if(argc > argi + 1){
             fprintf(stderr, "Error: only one command-line argument (filename) allowed.\n");
             errorSeen++;
         }
     }
 
-    // Set up getline pointers
-    char *line = NULL;
-    size_t size = 0;
+    if (bulkLoad) {
+        processBulk(fileptr);
+    }
+    else {
+        // Set up getline pointers
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t length;
+
+        // Keep parsing lines until EOF reached
+        while ((length = getline(&line, &size, fileptr)) != EOF) {
+            processLine(line, line + length);
+        }
+        free(line);
+    }
 
-    // Keep parsing lines until EOF reached
-    while (getline(&line, &size, fileptr) != EOF) {
-        processLine(line);
+    if (appendLog != NULL) {
+        fclose(appendLog);
+    }
+    if (saveFile != NULL) {
+        saveGraph(saveFile);
     }
-    free(line);
 
     // Free everything
     pageNode *pageptr = head;
     pageNode *temp;
     while (pageptr != NULL) {
         temp = pageptr->next;
-        freeLinkNodes(pageptr);
-        free(pageptr->pageName);
+        freeLinks(pageptr);
+        if (!inGraphFile(pageptr->pageName)) {
+            free(pageptr->pageName);
+        }
         free(pageptr);
         pageptr = temp;
     }
+    free(pageTable);
+    free(pageHash);
+    free(lineTokens);
+    freeIndex();
+    freeCsr();
+    freeBfsThreads();
+    if (graphData != NULL) {
+        munmap(graphData, graphSize);
+    }
 
     //Close the file, if something other than stdin was used
     if (fromFile) {